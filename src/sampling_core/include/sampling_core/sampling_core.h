@@ -2,17 +2,25 @@
 
 #include <ros/ros.h>
 
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <unordered_map>
+#include <unordered_set>
 
 #include "sampling_core/sampling_core_params.h"
 #include "sampling_core/sampling_core_performance_evaluation.h"
-#include "sampling_msgs/AddSampleToModel.h"
 #include "sampling_msgs/AgentLocation.h"
+#include "sampling_msgs/BatchSamplingGoal.h"
 #include "sampling_msgs/KillAgent.h"
 #include "sampling_msgs/Sample.h"
 #include "sampling_msgs/SamplingGoal.h"
+#include "sampling_modeling/mixture_gaussian_process.h"
 #include "sampling_online_learning/online_learning_handler.h"
 #include "sampling_partition/weighted_voronoi_partition.h"
+#include "sampling_utils/mpsc_queue.h"
 #include "sampling_visualization/agent_visualization_handler.h"
 #include "sampling_visualization/grid_visualization_handler.h"
 
@@ -21,7 +29,36 @@ namespace core {
 
 // todo agent die
 
-const std::string KModelingNamespace = "modeling/";
+const std::string KModelingNamespace = "modeling";
+
+/// Immutable prediction published by the model update worker. Readers hold
+/// on to a snapshot, so mean and variance always come from the same fit.
+struct PredictionSnapshot {
+  // Increases with every published prediction
+  int version;
+
+  // Number of collected samples the model was fitted with
+  int sample_count;
+
+  std::vector<double> mean;
+
+  std::vector<double> var;
+};
+
+/// Latest state of one agent. A slot is only written by location messages
+/// of its agent and by KillAgent, readers never lock.
+struct AgentSlot {
+  AgentSlot() : is_dead(false) {}
+
+  // Read and replaced with std::atomic_load / std::atomic_store
+  std::shared_ptr<const sampling_msgs::AgentLocation> location;
+
+  // Last assigned goal until the agent reports a sample, same access rules
+  // as location
+  std::shared_ptr<const geometry_msgs::Point> target;
+
+  std::atomic<bool> is_dead;
+};
 
 class SamplingCore {
  public:
@@ -30,11 +67,14 @@ class SamplingCore {
   static std::unique_ptr<SamplingCore> MakeUniqueFromRos(ros::NodeHandle &nh,
                                                          ros::NodeHandle &ph);
 
+  ~SamplingCore();
+
   bool Loop();
 
  private:
   SamplingCore(
       ros::NodeHandle &nh, const SamplingCoreParams &params,
+      std::unique_ptr<modeling::MixtureGaussianProcess> modeling_handler,
       std::unique_ptr<partition::WeightedVoronoiPartition> partition_handler,
       std::unique_ptr<learning::OnlineLearningHandler> learning_handler,
       std::unique_ptr<visualization::AgentVisualizationHandler>
@@ -50,23 +90,42 @@ class SamplingCore {
 
   ros::Subscriber sample_subscriber_;
 
-  std::unordered_map<std::string, sampling_msgs::AgentLocation>
-      agents_locations_;
-
-  ros::ServiceClient modeling_add_test_location_client_;
-
-  ros::ServiceClient modeling_add_sample_client_;
+  // One slot per agent in params_.agent_ids order, never resized
+  std::vector<AgentSlot> agent_slots_;
 
-  ros::ServiceClient modeling_update_model_client_;
-
-  ros::ServiceClient modeling_predict_client_;
+  // Fixed after construction, so lookups need no lock
+  std::unordered_map<std::string, int> agent_slot_index_;
 
   ros::ServiceServer kill_agent_server_;
 
   ros::ServiceServer sampling_goal_server_;
 
+  ros::ServiceServer batch_sampling_goal_server_;
+
   std::vector<ros::ServiceClient> agent_check_clients_;
 
+  // Modeling, only touched by the model update worker once initialized
+  std::unique_ptr<modeling::MixtureGaussianProcess> modeling_handler_;
+
+  std::thread model_update_thread_;
+
+  // Guards pending_samples_ and stop_model_update_
+  std::mutex model_update_mutex_;
+
+  std::condition_variable model_update_condition_;
+
+  std::vector<sampling_msgs::Sample> pending_samples_;
+
+  bool stop_model_update_;
+
+  // Read and replaced with std::atomic_load / std::atomic_store
+  std::shared_ptr<const PredictionSnapshot> prediction_;
+
+  // Received samples the published prediction does not include yet
+  std::vector<sampling_msgs::Sample> unmodeled_samples_;
+
+  std::mutex unmodeled_samples_mutex_;
+
   // Partition
   std::unique_ptr<partition::WeightedVoronoiPartition> partition_handler_;
 
@@ -86,10 +145,22 @@ class SamplingCore {
   void AgentLocationUpdateCallback(
       const sampling_msgs::AgentLocationConstPtr &msg);
 
+  // Filled by sample callbacks, drained by Loop
+  utils::MPSCQueue<sampling_msgs::Sample> sample_queue_;
+
+  // Only touched by Loop
   std::vector<sampling_msgs::Sample> sample_buffer_;
 
-  bool SampleToSrv(const std::vector<sampling_msgs::Sample> &samples,
-                   sampling_msgs::AddSampleToModel &srv);
+  void DrainSampleQueue();
+
+  /// Locations of all live agents, false if one of them has not reported
+  /// yet.
+  bool GetLiveAgentLocations(
+      std::vector<sampling_msgs::AgentLocation> &agent_locations) const;
+
+  bool SampleToMatrix(const std::vector<sampling_msgs::Sample> &samples,
+                      Eigen::MatrixXd &positions,
+                      Eigen::VectorXd &measurements);
 
   void SampleUpdateCallback(const sampling_msgs::SampleConstPtr &msg);
 
@@ -97,27 +168,49 @@ class SamplingCore {
 
   bool Initialize();
 
-  bool UpdateModel();
+  /// Hands buffered samples to the model update worker without waiting.
+  void ScheduleModelUpdate();
+
+  void ModelUpdateWorker();
+
+  bool UpdateModel(const std::vector<sampling_msgs::Sample> &samples);
 
-  bool UpdatePrediction();
+  /// Predicts on the test locations and publishes a new snapshot.
+  bool UpdatePrediction(const int &sample_count);
+
+  std::shared_ptr<const PredictionSnapshot> GetPrediction() const;
+
+  /// Drops samples handed to the model update worker from
+  /// unmodeled_samples_ once they are modeled or lost.
+  void ForgetUnmodeledSamples(
+      const std::vector<sampling_msgs::Sample> &samples);
+
+  /// Prediction variance lowered around unmodeled samples and around the
+  /// pending targets of all agents but those in requesting_slots, which
+  /// are about to get new goals.
+  bool FantasizeVariance(const PredictionSnapshot &prediction,
+                         const std::vector<int> &requesting_slots,
+                         std::vector<double> &variance);
+
+  void SetAgentTarget(
+      const std::string &agent_id,
+      const std::shared_ptr<const geometry_msgs::Point> &target);
 
   bool UpdateVisualization();
 
   bool AssignSamplingGoal(sampling_msgs::SamplingGoal::Request &req,
                           sampling_msgs::SamplingGoal::Response &res);
 
+  /// Assigns goals to all requesting agents from one partition, goals
+  /// picked later keep away from the earlier ones. Agents without cells
+  /// and repeated entries of an agent are reported unsuccessful.
+  bool AssignSamplingGoals(sampling_msgs::BatchSamplingGoal::Request &req,
+                           sampling_msgs::BatchSamplingGoal::Response &res);
+
   bool KillAgent(sampling_msgs::KillAgent::Request &req,
                  sampling_msgs::KillAgent::Response &res);
 
-  std::vector<double> updated_mean_prediction_;
-
-  std::vector<double> updated_var_prediction_;
-
-  std::unordered_set<std::string> died_agents_;
-
-  int sample_count_;
-
-  bool is_initialized_;
+  std::atomic<bool> is_initialized_;
 };
 }  // namespace core
 }  // namespace sampling
@@ -2,9 +2,9 @@
 
 #include <std_srvs/Trigger.h>
 
+#include <algorithm>
+
 #include "sampling_agent/sampling_agent.h"
-#include "sampling_msgs/AddTestPositionToModel.h"
-#include "sampling_msgs/ModelPredict.h"
 #include "sampling_utils/utils.h"
 
 namespace sampling {
@@ -19,6 +19,14 @@ std::unique_ptr<SamplingCore> SamplingCore::MakeUniqueFromRos(
     return nullptr;
   }
 
+  ros::NodeHandle modeling_ph(ph, KModelingNamespace);
+  std::unique_ptr<modeling::MixtureGaussianProcess> modeling_ptr =
+      modeling::MixtureGaussianProcess::MakeUniqueFromRosParam(modeling_ph);
+  if (modeling_ptr == nullptr) {
+    ROS_ERROR_STREAM("Failed to create sampling modeling handler!");
+    return nullptr;
+  }
+
   std::unique_ptr<partition::WeightedVoronoiPartition> partition_ptr =
       partition::WeightedVoronoiPartition::MakeUniqueFromRosParam(
           params.agent_ids, params.test_locations, ph);
@@ -28,7 +36,8 @@ std::unique_ptr<SamplingCore> SamplingCore::MakeUniqueFromRos(
   }
 
   std::unique_ptr<learning::OnlineLearningHandler> learning_ptr =
-      learning::OnlineLearningHandler::MakeUniqueFromRosParam(ph);
+      learning::OnlineLearningHandler::MakeUniqueFromRosParam(
+          ph, params.test_locations);
 
   if (learning_ptr == nullptr) {
     ROS_ERROR_STREAM("Failed to create sampling learning handler!");
@@ -94,7 +103,8 @@ std::unique_ptr<SamplingCore> SamplingCore::MakeUniqueFromRos(
   }
 
   return std::unique_ptr<SamplingCore>(new SamplingCore(
-      nh, params, std::move(partition_ptr), std::move(learning_ptr),
+      nh, params, std::move(modeling_ptr), std::move(partition_ptr),
+      std::move(learning_ptr),
       std::move(agent_visualization_handler), grid_visualization_handlers,
       std::move(evaluation_handler)));
 }
@@ -103,6 +113,7 @@ std::unique_ptr<SamplingCore> SamplingCore::MakeUniqueFromRos(
 
 SamplingCore::SamplingCore(
     ros::NodeHandle &nh, const SamplingCoreParams &params,
+    std::unique_ptr<modeling::MixtureGaussianProcess> modeling_handler,
     std::unique_ptr<partition::WeightedVoronoiPartition> partition_handler,
     std::unique_ptr<learning::OnlineLearningHandler> learning_handler,
     std::unique_ptr<visualization::AgentVisualizationHandler>
@@ -111,38 +122,34 @@ SamplingCore::SamplingCore(
         &grid_visualization_handlers,
     std::unique_ptr<SamplingCorePerformanceEvaluation> evaluation_handler)
     : params_(params),
+      agent_slots_(params.agent_ids.size()),
+      modeling_handler_(std::move(modeling_handler)),
+      stop_model_update_(false),
       partition_handler_(std::move(partition_handler)),
       learning_handler_(std::move(learning_handler)),
       agent_visualization_handler_(std::move(agent_visualization_handler)),
       evaluation_handler_(std::move(evaluation_handler)),
-      is_initialized_(false),
-      sample_count_(0) {
+      is_initialized_(false) {
+  for (int i = 0; i < params.agent_ids.size(); ++i) {
+    agent_slot_index_[params.agent_ids[i]] = i;
+  }
   for (int i = 0; i < grid_visualization_handlers.size(); ++i) {
     grid_visualization_handlers_[grid_visualization_handlers[i]->GetName()] =
         std::move(grid_visualization_handlers[i]);
   }
 
-  modeling_add_test_location_client_ =
-      nh.serviceClient<sampling_msgs::AddTestPositionToModel>(
-          KModelingNamespace + "add_test_position");
-
   agent_location_subscriber_ =
       nh.subscribe("agent_location_channel", 1,
                    &SamplingCore::AgentLocationUpdateCallback, this);
   sample_subscriber_ = nh.subscribe("sample_channel", 1,
                                     &SamplingCore::SampleUpdateCallback, this);
-  modeling_add_sample_client_ =
-      nh.serviceClient<sampling_msgs::AddSampleToModel>(KModelingNamespace +
-                                                        "add_samples_to_model");
-  modeling_update_model_client_ =
-      nh.serviceClient<std_srvs::Trigger>(KModelingNamespace + "update_model");
-
-  modeling_predict_client_ = nh.serviceClient<sampling_msgs::ModelPredict>(
-      KModelingNamespace + "model_predict");
-
   sampling_goal_server_ = nh.advertiseService(
       "sampling_goal_channel", &SamplingCore::AssignSamplingGoal, this);
 
+  batch_sampling_goal_server_ =
+      nh.advertiseService("batch_sampling_goal_channel",
+                          &SamplingCore::AssignSamplingGoals, this);
+
   kill_agent_server_ =
       nh.advertiseService("kill_agent", &SamplingCore::KillAgent, this);
 
@@ -153,6 +160,15 @@ SamplingCore::SamplingCore(
   }
 }
 
+SamplingCore::~SamplingCore() {
+  {
+    std::unique_lock<std::mutex> lock(model_update_mutex_);
+    stop_model_update_ = true;
+  }
+  model_update_condition_.notify_all();
+  if (model_update_thread_.joinable()) model_update_thread_.join();
+}
+
 bool SamplingCore::Loop() {
   if (!is_initialized_) {
     ROS_INFO_STREAM("Sampling core is starting up!");
@@ -162,24 +178,16 @@ bool SamplingCore::Loop() {
       return false;
     } else {
       ROS_INFO_STREAM("Sampling core is initialized!");
+      model_update_thread_ =
+          std::thread(&SamplingCore::ModelUpdateWorker, this);
       is_initialized_ = true;
       return true;
     }
   }
 
-  if (sample_buffer_.size() >= params_.model_update_frequency_count) {
-    ROS_INFO_STREAM("Start updating model!");
-    if (!UpdateModel()) {
-      ROS_WARN_STREAM("Failed to update model!");
-      ROS_WARN_STREAM("Retry --- --- ---");
-      return false;
-    }
-    if (!UpdatePrediction()) {
-      ROS_WARN_STREAM("Failed to update prediction!");
-      ROS_WARN_STREAM("Retry --- --- ---");
-      return false;
-    }
-  }
+  DrainSampleQueue();
+  if (sample_buffer_.size() >= params_.model_update_frequency_count)
+    ScheduleModelUpdate();
 
   if (!UpdateVisualization()) {
     ROS_WARN_STREAM("Failed to update visualization!");
@@ -192,9 +200,17 @@ bool SamplingCore::Loop() {
 
 void SamplingCore::AgentLocationUpdateCallback(
     const sampling_msgs::AgentLocationConstPtr &msg) {
-  // todo: check valid
-  if (!died_agents_.count(msg->agent_id))
-    agents_locations_[msg->agent_id] = *msg;
+  const std::unordered_map<std::string, int>::const_iterator it =
+      agent_slot_index_.find(msg->agent_id);
+  if (it == agent_slot_index_.end()) {
+    ROS_WARN_STREAM("Location from unknown agent : " << msg->agent_id);
+    return;
+  }
+  AgentSlot &slot = agent_slots_[it->second];
+  if (slot.is_dead) return;
+  std::atomic_store(&slot.location,
+                    std::shared_ptr<const sampling_msgs::AgentLocation>(
+                        std::make_shared<sampling_msgs::AgentLocation>(*msg)));
 }
 
 void SamplingCore::SampleUpdateCallback(
@@ -203,23 +219,54 @@ void SamplingCore::SampleUpdateCallback(
   ROS_INFO_STREAM("Measurement : " << msg->data << " from position ("
                                    << msg->position.x << "," << msg->position.y
                                    << ").");
-  sample_count_++;
-  sample_buffer_.push_back(*msg);
+  {
+    std::lock_guard<std::mutex> lock(unmodeled_samples_mutex_);
+    unmodeled_samples_.push_back(*msg);
+  }
+  sample_queue_.Push(*msg);
+  // The goal is reached, the sample stands in for it from now on
+  SetAgentTarget(msg->agent_id, nullptr);
   if (!learning_handler_->UpdateSampleCount(msg->position)) {
     ROS_WARN_STREAM("Failed to update sample account to online learner!");
   }
   return;
 }
 
-bool SamplingCore::SampleToSrv(
+void SamplingCore::DrainSampleQueue() {
+  sampling_msgs::Sample sample;
+  while (sample_queue_.Pop(sample)) {
+    sample_buffer_.push_back(sample);
+  }
+}
+
+bool SamplingCore::GetLiveAgentLocations(
+    std::vector<sampling_msgs::AgentLocation> &agent_locations) const {
+  agent_locations.clear();
+  agent_locations.reserve(params_.agent_ids.size());
+  for (int i = 0; i < params_.agent_ids.size(); ++i) {
+    if (agent_slots_[i].is_dead) continue;
+    const std::shared_ptr<const sampling_msgs::AgentLocation> location =
+        std::atomic_load(&agent_slots_[i].location);
+    if (location == nullptr) {
+      ROS_ERROR_STREAM("Do NOT have location information for "
+                       << params_.agent_ids[i]);
+      return false;
+    }
+    agent_locations.push_back(*location);
+  }
+  return true;
+}
+
+bool SamplingCore::SampleToMatrix(
     const std::vector<sampling_msgs::Sample> &samples,
-    sampling_msgs::AddSampleToModel &srv) {
+    Eigen::MatrixXd &positions, Eigen::VectorXd &measurements) {
   if (samples.empty()) return false;
-  srv.request.positions.reserve(samples.size());
-  srv.request.measurements.reserve(samples.size());
-  for (const sampling_msgs::Sample &sample : samples) {
-    srv.request.positions.push_back(sample.position);
-    srv.request.measurements.push_back(sample.data);
+  positions.resize(samples.size(), 2);
+  measurements.resize(samples.size());
+  for (int i = 0; i < samples.size(); ++i) {
+    positions(i, 0) = samples[i].position.x;
+    positions(i, 1) = samples[i].position.y;
+    measurements(i) = samples[i].data;
   }
   return true;
 }
@@ -238,146 +285,215 @@ bool SamplingCore::Initialize() {
 }
 
 bool SamplingCore::InitializeModelAndPrediction() {
-  sampling_msgs::AddTestPositionToModel add_location_srv;
-  add_location_srv.request.positions = params_.test_locations_msg;
-  if (!modeling_add_test_location_client_.call(add_location_srv) ||
-      !add_location_srv.response.success) {
-    ROS_ERROR_STREAM("Failed to add test locations to modeling node!");
+  if (!modeling_handler_->SetTestLocations(params_.test_locations)) {
+    ROS_ERROR_STREAM("Failed to add test locations to model!");
     return false;
   }
 
-  sampling_msgs::AddSampleToModel add_sample_srv;
-  add_sample_srv.request.positions.reserve(params_.initial_measurements.size());
-  add_sample_srv.request.measurements.reserve(
-      params_.initial_measurements.size());
-  for (int i = 0; i < params_.initial_measurements.size(); ++i) {
-    add_sample_srv.request.measurements.push_back(
-        params_.initial_measurements(i));
-    geometry_msgs::Point position;
-    position.x = params_.initial_locations(i, 0);
-    position.y = params_.initial_locations(i, 1);
-    add_sample_srv.request.positions.push_back(position);
-  }
-
-  if (modeling_add_sample_client_.call(add_sample_srv) &&
-      add_sample_srv.response.success) {
-    sample_buffer_.clear();
-  } else {
+  if (!modeling_handler_->AddSample(params_.initial_locations,
+                                    params_.initial_measurements)) {
     ROS_ERROR_STREAM("Model add initial samples failed!");
     return false;
   }
+  DrainSampleQueue();
+  sample_buffer_.clear();
+  {
+    std::lock_guard<std::mutex> lock(unmodeled_samples_mutex_);
+    unmodeled_samples_.clear();
+  }
 
-  std_srvs::Trigger update_model_srv;
-  if (!modeling_update_model_client_.call(update_model_srv) ||
-      !update_model_srv.response.success) {
+  if (!modeling_handler_->OptimizeModel()) {
     ROS_ERROR_STREAM("Model initial update failed!");
     return false;
   }
 
-  sampling_msgs::ModelPredict predict_srv;
-  if (modeling_predict_client_.call(predict_srv) &&
-      predict_srv.response.success) {
-    updated_mean_prediction_ = predict_srv.response.mean;
-    updated_var_prediction_ = predict_srv.response.var;
-  } else {
+  if (!UpdatePrediction(0)) {
     ROS_ERROR_STREAM("Model initial prediction failed!");
     return false;
   }
   return true;
 }
 
-bool SamplingCore::UpdateModel() {
-  if (sample_buffer_.size() < params_.model_update_frequency_count)
-    return false;
-  else {
-    sampling_msgs::AddSampleToModel add_sample_srv;
+void SamplingCore::ScheduleModelUpdate() {
+  {
+    std::unique_lock<std::mutex> lock(model_update_mutex_);
+    pending_samples_.insert(pending_samples_.end(), sample_buffer_.begin(),
+                            sample_buffer_.end());
+  }
+  sample_buffer_.clear();
+  model_update_condition_.notify_one();
+}
 
-    if (!SampleToSrv(sample_buffer_, add_sample_srv)) return false;
-    if (!modeling_add_sample_client_.call(add_sample_srv) ||
-        !add_sample_srv.response.success) {
-      return false;
+void SamplingCore::ModelUpdateWorker() {
+  int sample_count = 0;
+  while (true) {
+    std::vector<sampling_msgs::Sample> samples;
+    {
+      std::unique_lock<std::mutex> lock(model_update_mutex_);
+      model_update_condition_.wait(lock, [this] {
+        return stop_model_update_ || !pending_samples_.empty();
+      });
+      if (stop_model_update_) return;
+      samples.swap(pending_samples_);
     }
 
-    std_srvs::Trigger update_model_srv;
-    sample_buffer_.clear();
-    if (modeling_update_model_client_.call(update_model_srv) &&
-        update_model_srv.response.success) {
-      ROS_INFO_STREAM("Model is updated!");
-      return true;
-    } else {
-      return false;
+    ROS_INFO_STREAM("Start updating model!");
+    if (!UpdateModel(samples)) {
+      ROS_WARN_STREAM("Failed to update model!");
+      ForgetUnmodeledSamples(samples);
+      continue;
+    }
+    sample_count += samples.size();
+    const bool is_predicted = UpdatePrediction(sample_count);
+    ForgetUnmodeledSamples(samples);
+    if (!is_predicted) {
+      ROS_WARN_STREAM("Failed to update prediction!");
+      continue;
     }
-  }
-  return false;
-}
 
-bool SamplingCore::UpdatePrediction() {
-  sampling_msgs::ModelPredict srv;
-  if (modeling_predict_client_.call(srv) && srv.response.success) {
-    updated_mean_prediction_ = srv.response.mean;
-    updated_var_prediction_ = srv.response.var;
     if (evaluation_handler_ != nullptr) {
+      const std::shared_ptr<const PredictionSnapshot> prediction =
+          GetPrediction();
       if (!evaluation_handler_->UpdatePerformance(
-              sample_count_, updated_mean_prediction_, updated_var_prediction_))
+              prediction->sample_count, prediction->mean, prediction->var))
         ROS_WARN_STREAM("Failed to update performance evaluation!");
     }
+  }
+}
+
+bool SamplingCore::UpdateModel(
+    const std::vector<sampling_msgs::Sample> &samples) {
+  Eigen::MatrixXd positions;
+  Eigen::VectorXd measurements;
+  if (!SampleToMatrix(samples, positions, measurements)) return false;
+  if (!modeling_handler_->AddSample(positions, measurements)) return false;
+
+  if (modeling_handler_->OptimizeModel()) {
+    const modeling::EMStatistics &em = modeling_handler_->GetEMStatistics();
+    ROS_INFO_STREAM("Model is updated! EM "
+                    << (em.converged ? "converged" : "stopped") << " after "
+                    << em.iterations << " iterations, diff_P : "
+                    << em.diff_p);
     return true;
   }
   return false;
 }
 
+bool SamplingCore::UpdatePrediction(const int &sample_count) {
+  std::shared_ptr<PredictionSnapshot> snapshot =
+      std::make_shared<PredictionSnapshot>();
+  if (!modeling_handler_->Predict(params_.test_locations, snapshot->mean,
+                                  snapshot->var))
+    return false;
+  const std::shared_ptr<const PredictionSnapshot> previous = GetPrediction();
+  snapshot->version = previous == nullptr ? 0 : previous->version + 1;
+  snapshot->sample_count = sample_count;
+  std::atomic_store(&prediction_,
+                    std::shared_ptr<const PredictionSnapshot>(snapshot));
+  return true;
+}
+
+std::shared_ptr<const PredictionSnapshot> SamplingCore::GetPrediction() const {
+  return std::atomic_load(&prediction_);
+}
+
+void SamplingCore::ForgetUnmodeledSamples(
+    const std::vector<sampling_msgs::Sample> &samples) {
+  std::lock_guard<std::mutex> lock(unmodeled_samples_mutex_);
+  for (const sampling_msgs::Sample &sample : samples) {
+    const auto it = std::find_if(
+        unmodeled_samples_.begin(), unmodeled_samples_.end(),
+        [&](const sampling_msgs::Sample &unmodeled) {
+          return unmodeled.agent_id == sample.agent_id &&
+                 unmodeled.position.x == sample.position.x &&
+                 unmodeled.position.y == sample.position.y;
+        });
+    if (it != unmodeled_samples_.end()) unmodeled_samples_.erase(it);
+  }
+}
+
+bool SamplingCore::FantasizeVariance(const PredictionSnapshot &prediction,
+                                     const std::vector<int> &requesting_slots,
+                                     std::vector<double> &variance) {
+  // Reused between requests of the same service thread
+  thread_local std::vector<geometry_msgs::Point> positions;
+  positions.clear();
+  {
+    std::lock_guard<std::mutex> lock(unmodeled_samples_mutex_);
+    for (const sampling_msgs::Sample &sample : unmodeled_samples_) {
+      positions.push_back(sample.position);
+    }
+  }
+  for (int i = 0; i < agent_slots_.size(); ++i) {
+    if (agent_slots_[i].is_dead ||
+        std::find(requesting_slots.begin(), requesting_slots.end(), i) !=
+            requesting_slots.end()) {
+      continue;
+    }
+    const std::shared_ptr<const geometry_msgs::Point> target =
+        std::atomic_load(&agent_slots_[i].target);
+    if (target != nullptr) positions.push_back(*target);
+  }
+  variance = prediction.var;
+  return learning_handler_->FantasizeVariance(positions, variance);
+}
+
+void SamplingCore::SetAgentTarget(
+    const std::string &agent_id,
+    const std::shared_ptr<const geometry_msgs::Point> &target) {
+  const std::unordered_map<std::string, int>::const_iterator it =
+      agent_slot_index_.find(agent_id);
+  if (it == agent_slot_index_.end()) return;
+  std::atomic_store(&agent_slots_[it->second].target, target);
+}
+
 bool SamplingCore::UpdateVisualization() {
   // Update Agent Location
   std::vector<sampling_msgs::AgentLocation> agent_locations_msg;
   agent_locations_msg.reserve(params_.agent_ids.size());
-  for (const std::string &agent_id : params_.agent_ids) {
-    if (died_agents_.count(agent_id)) {
+  for (int i = 0; i < params_.agent_ids.size(); ++i) {
+    if (agent_slots_[i].is_dead) {
       sampling_msgs::AgentLocation msg;
-      msg.agent_id = agent_id;
+      msg.agent_id = params_.agent_ids[i];
       msg.position.x = agent::KRetreatPositionX_m;
       msg.position.y = agent::KRetreatPositionY_m;
       agent_locations_msg.push_back(msg);
-    } else if (agents_locations_.count(agent_id))
-      agent_locations_msg.push_back(agents_locations_[agent_id]);
+      continue;
+    }
+    const std::shared_ptr<const sampling_msgs::AgentLocation> location =
+        std::atomic_load(&agent_slots_[i].location);
+    if (location != nullptr) agent_locations_msg.push_back(*location);
   }
   if (!agent_visualization_handler_->UpdateMarker(agent_locations_msg)) {
     ROS_ERROR_STREAM("Failed to update robot location visualization");
     return false;
   }
 
+  // One snapshot for the whole tick, so mean and variance maps match
+  const std::shared_ptr<const PredictionSnapshot> prediction = GetPrediction();
   for (std::unordered_map<
            std::string,
            std::unique_ptr<visualization::GridVisualizationHandler>>::iterator
            it = grid_visualization_handlers_.begin();
        it != grid_visualization_handlers_.end(); ++it) {
     if (visualization::KPredictionMeanMapName.compare(it->first) == 0) {
-      if (updated_mean_prediction_.empty()) {
+      if (prediction == nullptr || prediction->mean.empty()) {
         ROS_ERROR_STREAM(
             "Prediction Mean for visualization update is not ready yet!");
         return false;
       }
-      it->second->UpdateMarker(updated_mean_prediction_);
+      it->second->UpdateMarker(prediction->mean);
     } else if (visualization::KPredictionVarianceMapName.compare(it->first) ==
                0) {
-      if (updated_var_prediction_.empty()) {
+      if (prediction == nullptr || prediction->var.empty()) {
         ROS_ERROR_STREAM(
             "Prediction Variance for visualization update is not ready yet!");
         return false;
       }
-      it->second->UpdateMarker(updated_var_prediction_);
+      it->second->UpdateMarker(prediction->var);
     } else if (visualization::KPartitionMapName.compare(it->first) == 0) {
       std::vector<sampling_msgs::AgentLocation> agent_locations;
-      agent_locations.reserve(params_.agent_ids.size());
-      for (const std::string &agent_id : params_.agent_ids) {
-        if (died_agents_.count(agent_id)) {
-          continue;
-        } else if (!agents_locations_.count(agent_id)) {
-          ROS_ERROR_STREAM("Do NOT have location information for " << agent_id);
-          return false;
-        } else {
-          agent_locations.push_back(agents_locations_[agent_id]);
-        }
-      }
+      if (!GetLiveAgentLocations(agent_locations)) return false;
 
       std::vector<int> partition_index;
       if (!partition_handler_->ComputePartitionForMap(agent_locations,
@@ -402,71 +518,184 @@ bool SamplingCore::UpdateVisualization() {
 bool SamplingCore::AssignSamplingGoal(
     sampling_msgs::SamplingGoal::Request &req,
     sampling_msgs::SamplingGoal::Response &res) {
-  if (!is_initialized_ || updated_mean_prediction_.empty() ||
-      updated_var_prediction_.empty()) {
+  // Never waits for a model refit, the latest published snapshot is used
+  const std::shared_ptr<const PredictionSnapshot> prediction = GetPrediction();
+  if (!is_initialized_ || prediction == nullptr) {
     ROS_WARN_STREAM("Unable to assign sampling goal to : "
                     << req.agent_location.agent_id
                     << " due to environment not updated!");
     return false;
   }
 
-  std::vector<sampling_msgs::AgentLocation> agent_locations;
-  agent_locations.reserve(params_.agent_ids.size());
-  for (const std::string &agent_id : params_.agent_ids) {
-    if (died_agents_.count(agent_id)) {
-      continue;
-    } else if (!agents_locations_.count(agent_id)) {
-      ROS_ERROR_STREAM("Do NOT have location information for " << agent_id);
-      return false;
-    } else {
-      agent_locations.push_back(agents_locations_[agent_id]);
-    }
-  }
+  // Reused by every request on this service thread, so that a request
+  // served from the cached partition allocates nothing
+  thread_local std::vector<sampling_msgs::AgentLocation> agent_locations;
+  if (!GetLiveAgentLocations(agent_locations)) return false;
 
-  std::vector<int> partition_index;
-  if (!partition_handler_->ComputePartitionForAgent(
-          req.agent_location.agent_id, agent_locations, partition_index)) {
+  const std::shared_ptr<const partition::PartitionResult> partition =
+      partition_handler_->GetPartition(agent_locations);
+  if (partition == nullptr) {
     ROS_ERROR_STREAM("Failed to generate partition for "
                      << req.agent_location.agent_id);
     return false;
   }
-  if (partition_index.empty()) {
+  const auto cells = partition->agent_cells.find(req.agent_location.agent_id);
+  if (cells == partition->agent_cells.end() || cells->second.empty()) {
     ROS_WARN_STREAM("Agent : " << req.agent_location.agent_id
                                << " does NOT belong to any partition");
     return false;
   }
 
-  Eigen::MatrixXd agent_responsible_locations;
-  if (!utils::ExtractRows(params_.test_locations, partition_index,
-                          agent_responsible_locations)) {
-    ROS_ERROR_STREAM("Failed to allocate partition locations for "
-                     << req.agent_location.agent_id);
-    return false;
+  // Goals of other agents and samples not modeled yet lower the variance
+  // around them, so agents do not chase the same stale variance
+  const std::vector<double> *variance = &prediction->var;
+  if (learning_handler_->UsesFantasizedVariance()) {
+    thread_local std::vector<int> requesting_slots;
+    thread_local std::vector<double> fantasized_var;
+    requesting_slots.clear();
+    const auto slot = agent_slot_index_.find(req.agent_location.agent_id);
+    if (slot != agent_slot_index_.end()) {
+      requesting_slots.push_back(slot->second);
+    }
+    if (!FantasizeVariance(*prediction, requesting_slots, fantasized_var)) {
+      ROS_ERROR_STREAM("Failed to fantasize variance for "
+                       << req.agent_location.agent_id);
+      return false;
+    }
+    variance = &fantasized_var;
   }
 
-  std::vector<double> mean =
-      utils::Extract(updated_mean_prediction_, partition_index);
-  std::vector<double> var =
-      utils::Extract(updated_var_prediction_, partition_index);
-
   geometry_msgs::Point informative_point;
 
-  if (!learning_handler_->InformativeSelection(agent_responsible_locations,
-                                               mean, var, informative_point)) {
+  bool is_selected;
+  if (learning_handler_->IsPathPlanning()) {
+    const std::string &agent_id = req.agent_location.agent_id;
+    is_selected = learning_handler_->PathInformativeSelection(
+        cells->second, prediction->mean, *variance,
+        req.agent_location.position,
+        [&](const geometry_msgs::Point &position,
+            const std::vector<int> &target_cells, std::vector<double> &cost) {
+          return partition_handler_->GetTravelCost(agent_id, position,
+                                                   target_cells, cost);
+        },
+        informative_point);
+  } else {
+    is_selected = learning_handler_->InformativeSelection(
+        cells->second, prediction->mean, *variance, informative_point);
+  }
+  if (!is_selected) {
     ROS_ERROR_STREAM("Failed to select informative point for "
                      << req.agent_location.agent_id);
     return false;
   }
 
   res.target_position = informative_point;
+  if (learning_handler_->UsesFantasizedVariance()) {
+    SetAgentTarget(req.agent_location.agent_id,
+                   std::make_shared<const geometry_msgs::Point>(
+                       informative_point));
+  }
+
+  return true;
+}
+
+bool SamplingCore::AssignSamplingGoals(
+    sampling_msgs::BatchSamplingGoal::Request &req,
+    sampling_msgs::BatchSamplingGoal::Response &res) {
+  const std::shared_ptr<const PredictionSnapshot> prediction = GetPrediction();
+  if (!is_initialized_ || prediction == nullptr) {
+    ROS_WARN_STREAM(
+        "Unable to assign sampling goals due to environment not updated!");
+    return false;
+  }
+
+  thread_local std::vector<sampling_msgs::AgentLocation> agent_locations;
+  if (!GetLiveAgentLocations(agent_locations)) return false;
+
+  const std::shared_ptr<const partition::PartitionResult> partition =
+      partition_handler_->GetPartition(agent_locations);
+  if (partition == nullptr) {
+    ROS_ERROR_STREAM("Failed to generate partition for batch request");
+    return false;
+  }
+
+  // Partitions are disjoint, so the agents are scored in one pass over
+  // their own cells
+  res.success.assign(req.agent_locations.size(), false);
+  res.target_positions.assign(req.agent_locations.size(),
+                              geometry_msgs::Point());
+  std::vector<const std::vector<int> *> location_ids;
+  std::vector<int> requests;
+  std::unordered_set<std::string> requested_ids;
+  for (int i = 0; i < req.agent_locations.size(); ++i) {
+    // A repeated agent keeps the goal of its first entry only
+    if (!requested_ids.insert(req.agent_locations[i].agent_id).second) {
+      ROS_WARN_STREAM("Agent : " << req.agent_locations[i].agent_id
+                                 << " is requested more than once");
+      continue;
+    }
+    const auto cells =
+        partition->agent_cells.find(req.agent_locations[i].agent_id);
+    if (cells == partition->agent_cells.end() || cells->second.empty()) {
+      ROS_WARN_STREAM("Agent : " << req.agent_locations[i].agent_id
+                                 << " does NOT belong to any partition");
+      continue;
+    }
+    location_ids.push_back(&cells->second);
+    requests.push_back(i);
+  }
+
+  const std::vector<double> *variance = &prediction->var;
+  std::vector<double> fantasized_var;
+  if (learning_handler_->UsesFantasizedVariance()) {
+    // Only agents that get a goal here are excluded, the targets and
+    // positions of the others still lower the variance
+    std::vector<int> requesting_slots;
+    for (const int &i : requests) {
+      const auto slot =
+          agent_slot_index_.find(req.agent_locations[i].agent_id);
+      if (slot != agent_slot_index_.end()) {
+        requesting_slots.push_back(slot->second);
+      }
+    }
+    if (!FantasizeVariance(*prediction, requesting_slots, fantasized_var)) {
+      ROS_ERROR_STREAM("Failed to fantasize variance for batch request");
+      return false;
+    }
+    variance = &fantasized_var;
+  }
+
+  std::vector<geometry_msgs::Point> points;
+  if (!learning_handler_->BatchInformativeSelection(
+          location_ids, prediction->mean, *variance, points)) {
+    ROS_ERROR_STREAM("Failed to select informative points for batch request");
+    return false;
+  }
 
+  for (int k = 0; k < requests.size(); ++k) {
+    res.success[requests[k]] = true;
+    res.target_positions[requests[k]] = points[k];
+    if (learning_handler_->UsesFantasizedVariance()) {
+      SetAgentTarget(req.agent_locations[requests[k]].agent_id,
+                     std::make_shared<const geometry_msgs::Point>(points[k]));
+    }
+  }
   return true;
 }
 
 bool SamplingCore::KillAgent(sampling_msgs::KillAgent::Request &req,
                              sampling_msgs::KillAgent::Response &res) {
-  died_agents_.insert(req.agent_id);
-  agents_locations_.erase(req.agent_id);
+  const std::unordered_map<std::string, int>::const_iterator it =
+      agent_slot_index_.find(req.agent_id);
+  if (it == agent_slot_index_.end()) {
+    ROS_WARN_STREAM("Unable to kill unknown agent : " << req.agent_id);
+    res.success = false;
+    return true;
+  }
+  AgentSlot &slot = agent_slots_[it->second];
+  slot.is_dead = true;
+  std::atomic_store(&slot.location,
+                    std::shared_ptr<const sampling_msgs::AgentLocation>());
   res.success = true;
   return true;
 }
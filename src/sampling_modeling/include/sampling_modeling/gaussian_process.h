@@ -0,0 +1,178 @@
+/**
+ * Gaussian process regression with RBF kernel
+ * reference: http://krasserm.github.io/2018/03/19/gaussian-processes/
+ */
+
+#pragma once
+
+#include <Eigen/Dense>
+
+#include "sampling_modeling/squared_distance_cache.h"
+
+namespace sampling {
+namespace modeling {
+
+const double KGaussianProcessJitter = 1e-8;
+const int KKernelOptimizationMaxIteration = 50;
+const double KKernelOptimizationTolerance = 1e-5;
+const double KKernelMinHyperparam = 1e-3;
+// Curvature pairs kept by L-BFGS
+const int KLBFGSMemory = 5;
+const int KLineSearchMaxIteration = 20;
+// Armijo sufficient decrease constant
+const double KLineSearchDecrease = 1e-4;
+
+class RBFKernel {
+ public:
+  RBFKernel() = delete;
+
+  RBFKernel(const double &length_scale, const double &sigma_f);
+
+  /// Kernel matrix from precomputed pairwise squared distances
+  Eigen::MatrixXd Compute(const Eigen::MatrixXd &sqdist) const;
+
+  static Eigen::MatrixXd ComputeKernel(const Eigen::MatrixXd &sqdist,
+                                       const double &length_scale,
+                                       const double &sigma_f);
+
+  void UpdateKernel(const double &length_scale, const double &sigma_f);
+
+  double GetLengthScale() const;
+
+  double GetSigmaF() const;
+
+ private:
+  double length_scale_;
+
+  double sigma_f_;
+};
+
+/// Work done on the exact Cholesky factor by UpdateData
+struct FactorStatistics {
+  int factorizations = 0;
+
+  int extensions = 0;
+
+  // Calls that kept the factor as it was
+  int reuses = 0;
+};
+
+class GaussianProcess {
+ public:
+  GaussianProcess() = delete;
+
+  /// The factor is kept while every noise weight on its rows stays within
+  /// noise_weight_tolerance of the weight it was built with. Zero only
+  /// keeps it for unchanged noise.
+  GaussianProcess(const double &length_scale, const double &sigma_f,
+                  const double &sigma_y,
+                  const double &noise_weight_tolerance = 0.0);
+
+  /// Factorizes K_train_train + sigma_y^2 * diag(1 / noise_weight) on the
+  /// shared squared distances. Weights come from mixture responsibilities;
+  /// pass an empty vector for a homoscedastic GP.
+  /// If the distances were only extended since the previous call, the
+  /// kernel is unchanged and the noise on the existing rows is kept (see
+  /// the constructor), the cached Cholesky factor is extended in
+  /// O(n^2 * m) instead of refactorized in O(n^3). Once the cache switches
+  /// to inducing points, a sparse (DTC) approximation is used whose update
+  /// is O(n * m^2) for m inducing points, with or without noise changes.
+  bool UpdateData(const SquaredDistanceCache &distance,
+                  const Eigen::VectorXd &y_train,
+                  const Eigen::VectorXd &noise_weight);
+
+  /// Posterior mean and per-location variance from the squared distances
+  /// between the basis of the last UpdateData and the test locations. The
+  /// test covariance is never formed, only its diagonal. Callers tile the
+  /// test locations to bound memory.
+  bool PosteriorPredict(const Eigen::MatrixXd &basis_test_sqdist,
+                        Eigen::VectorXd &mean, Eigen::VectorXd &var) const;
+
+  /// Minimizes the negative log marginal likelihood over (length_scale,
+  /// sigma_f) given the train x train squared distances, starting from the
+  /// current kernel.
+  bool OptimizeKernel(const Eigen::MatrixXd &train_sqdist,
+                      const Eigen::VectorXd &y_train);
+
+  /// L-BFGS on the negative log marginal likelihood over log(length_scale,
+  /// sigma_f) with analytic gradients, starting from and returning theta.
+  /// Returns the final value, infinity if the start is invalid. Does not
+  /// touch the GP, so several starts may run concurrently.
+  double MinimizeNegativeLogLikelihood(const Eigen::MatrixXd &train_sqdist,
+                                       const Eigen::VectorXd &y_train,
+                                       Eigen::Vector2d &theta) const;
+
+  /// The factor is rebuilt on the next UpdateData if the kernel changed.
+  void UpdateKernel(const double &length_scale, const double &sigma_f);
+
+  const RBFKernel &GetKernel() const;
+
+  const FactorStatistics &GetFactorStatistics() const;
+
+ private:
+  bool UpdateSparseData(const SquaredDistanceCache &distance,
+                        const Eigen::VectorXd &y_train,
+                        const Eigen::VectorXd &noise);
+
+  /// Number of leading training rows whose factor can be reused
+  int CachedSampleSize(const SquaredDistanceCache &distance,
+                       const Eigen::VectorXd &noise_weight,
+                       const Eigen::VectorXd &noise) const;
+
+  bool FactorizeCovariance(const SquaredDistanceCache &distance,
+                           const Eigen::VectorXd &noise_weight,
+                           const Eigen::VectorXd &noise);
+
+  bool ExtendCovarianceFactor(const SquaredDistanceCache &distance,
+                              const Eigen::VectorXd &noise_weight,
+                              const Eigen::VectorXd &noise);
+
+  /// Value and gradient with respect to log_theta = log(length_scale,
+  /// sigma_f), both from a single Cholesky factorization.
+  double NegativeLogLikelihood(const Eigen::MatrixXd &train_sqdist,
+                               const Eigen::VectorXd &y_train,
+                               const Eigen::Vector2d &log_theta,
+                               Eigen::Vector2d &gradient) const;
+
+  RBFKernel kernel_;
+
+  double sigma_y_;
+
+  double noise_weight_tolerance_;
+
+  // Generation of the squared distances the factor was built on
+  int distance_generation_;
+
+  // Number of training rows covered by the factor
+  int num_factorized_;
+
+  bool is_sparse_;
+
+  // Diagonal noise added to the training covariance
+  Eigen::VectorXd noise_;
+
+  // Noise weights the factor was built with, empty for a homoscedastic GP
+  Eigen::VectorXd noise_weight_;
+
+  // Lower Cholesky factor of the noisy training covariance
+  Eigen::MatrixXd cholesky_;
+
+  // False once hyperparameters change and the factor must be rebuilt
+  bool is_factor_valid_;
+
+  // (K + noise)^-1 * y_train, or its projection on the inducing points
+  Eigen::VectorXd alpha_;
+
+  // Sparse approximation, lower Cholesky factor of K_inducing_inducing
+  Eigen::MatrixXd inducing_cholesky_;
+
+  // L_inducing^-1 * K_inducing_train, extended as samples are appended
+  Eigen::MatrixXd inducing_projection_;
+
+  // Lower Cholesky factor of I + V * noise^-1 * V^T, V = inducing_projection_
+  Eigen::MatrixXd sparse_cholesky_;
+
+  FactorStatistics factor_statistics_;
+};
+}  // namespace modeling
+}  // namespace sampling
@@ -0,0 +1,127 @@
+/**
+ * Mixture of Gaussian processes learnt with EM
+ * reference: http://krasserm.github.io/2018/03/19/gaussian-processes/
+ */
+
+#pragma once
+
+#include <ros/ros.h>
+
+#include <Eigen/Dense>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "sampling_modeling/gaussian_process.h"
+#include "sampling_modeling/mixture_gaussian_process_params.h"
+#include "sampling_modeling/squared_distance_cache.h"
+#include "sampling_utils/thread_pool.h"
+
+namespace sampling {
+namespace modeling {
+
+const double KResponsibilityFloor = 1e-6;
+// Random kernel restarts are drawn within exp(+-range) of the current kernel
+const double KKernelRestartLogRange = 1.0;
+// Refitted hyperparameters closer than this relative change to the current
+// ones are dropped, so that the cached factors stay valid
+const double KKernelUpdateRelativeTolerance = 0.01;
+
+/// Convergence of one EM run
+struct EMStatistics {
+  int iterations = 0;
+
+  // Largest responsibility change in the last iteration
+  double diff_p = 0.0;
+
+  bool converged = false;
+};
+
+class MixtureGaussianProcess {
+ public:
+  MixtureGaussianProcess() = delete;
+
+  static std::unique_ptr<MixtureGaussianProcess> MakeUniqueFromRosParam(
+      ros::NodeHandle &ph);
+
+  /// Inducing points for the sparse mode are picked from the test locations
+  /// by farthest point sampling.
+  bool SetTestLocations(const Eigen::MatrixXd &test_locations);
+
+  /// Responsibilities of new samples are warm-started from the gating
+  /// prediction at their locations, so EM only has to refine them.
+  bool AddSample(const Eigen::MatrixXd &x, const Eigen::VectorXd &y);
+
+  /// Runs EM over the experts and, while the sample count is below
+  /// online_optimization_threshold, refits kernels of experts and gating
+  /// GPs.
+  bool OptimizeModel();
+
+  /// Test locations are processed in tiles sized by KPredictionTileBytes;
+  /// the squared distances of a tile are computed once and shared by all
+  /// experts and gating GPs.
+  bool Predict(const Eigen::MatrixXd &x_test, std::vector<double> &mean,
+               std::vector<double> &var);
+
+  int GetSampleCount() const;
+
+  const EMStatistics &GetEMStatistics() const;
+
+ private:
+  MixtureGaussianProcess(const MixtureGaussianProcessParams &params);
+
+  bool EnableSparseApproximation();
+
+  /// Gating prediction at x normalized per row, random rows before any
+  /// sample has been added.
+  bool InitialResponsibility(const Eigen::MatrixXd &x, Eigen::MatrixXd &p);
+
+  bool Expectation(const Eigen::MatrixXd &pred_mean,
+                   const Eigen::MatrixXd &pred_var);
+
+  /// Expert noise is weighted by the responsibilities p_, which every
+  /// Expectation step changes on all rows. Experts keep their factor while
+  /// no responsibility moved by more than em_epsilon from the one it was
+  /// built with, the tolerance EM converges to. A converged EM run thus
+  /// leaves factors that the next update extends in O(n^2 * m), larger
+  /// moves refactorize in O(n^3).
+  bool Maximization(Eigen::MatrixXd &pred_mean, Eigen::MatrixXd &pred_var);
+
+  bool EMOptimize();
+
+  /// Every (GP, start) pair is an independent L-BFGS run on the thread
+  /// pool, each GP then keeps its best result unless it is within
+  /// KKernelUpdateRelativeTolerance of the current kernel. In sparse mode
+  /// the kernels are fit on num_inducing_points evenly strided samples, so
+  /// the cost does not grow with the sample count.
+  bool OptimizeKernels();
+
+  /// Runs task(i) for i in [0, num_tasks) on the thread pool and returns
+  /// false if any of them failed.
+  bool ForEachGP(const int &num_tasks, const std::function<bool(int)> &task);
+
+  MixtureGaussianProcessParams params_;
+
+  std::vector<GaussianProcess> gps_;
+
+  std::vector<GaussianProcess> gating_gps_;
+
+  Eigen::MatrixXd x_train_;
+
+  Eigen::VectorXd y_train_;
+
+  // Responsibility of each expert for each training sample
+  Eigen::MatrixXd p_;
+
+  Eigen::MatrixXd inducing_points_;
+
+  // Squared distances shared by every expert and gating GP
+  SquaredDistanceCache distance_;
+
+  EMStatistics em_statistics_;
+
+  // Runs the independent experts and gating GPs concurrently
+  std::unique_ptr<utils::ThreadPool> thread_pool_;
+};
+}  // namespace modeling
+}  // namespace sampling
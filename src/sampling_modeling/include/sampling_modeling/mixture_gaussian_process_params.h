@@ -0,0 +1,72 @@
+#pragma once
+
+#include <ros/ros.h>
+
+#include <string>
+#include <vector>
+
+namespace sampling {
+namespace modeling {
+
+const int KNumGP = 3;
+const double KEMEpsilon = 0.03;
+const int KEMMaxIteration = 100;
+const int KOnlineOptimizationThreshold = 1000;
+// Extra random starts per kernel optimization
+const int KKernelOptimizationRestarts = 0;
+// Non-positive threshold keeps the exact Gaussian processes
+const int KSparseGPThreshold = 0;
+const int KNumInducingPoints = 200;
+// Non-positive thread count uses all hardware threads
+const int KModelingThreads = 0;
+const std::vector<double> KDefaultKernelParam{0.5, 0.5, 0.1};
+
+class GaussianProcessParams {
+ public:
+  GaussianProcessParams();
+
+  bool LoadFromVector(const std::vector<double> &param);
+
+  double length_scale;
+
+  double sigma_f;
+
+  double sigma_y;
+};
+
+class MixtureGaussianProcessParams {
+ public:
+  MixtureGaussianProcessParams();
+
+  bool LoadFromRosParams(ros::NodeHandle &ph);
+
+  int num_gp;
+
+  std::vector<GaussianProcessParams> modeling_gp_params;
+
+  std::vector<GaussianProcessParams> gating_gp_params;
+
+  double em_epsilon;
+
+  int em_max_iteration;
+
+  bool online_kernel_optimization;
+
+  // Kernels are refitted up to this sample count. Above sparse_gp_threshold
+  // the refit only uses a subset of the samples, so it may go further.
+  int online_optimization_threshold;
+
+  // Random restarts run concurrently with the start from the current kernel
+  int kernel_optimization_restarts;
+
+  // Switch to inducing point approximation above this sample count
+  int sparse_gp_threshold;
+
+  // Also the number of samples kernels are optimized on in sparse mode
+  int num_inducing_points;
+
+  // Experts and gating GPs are updated concurrently on this many threads
+  int num_threads;
+};
+}  // namespace modeling
+}  // namespace sampling
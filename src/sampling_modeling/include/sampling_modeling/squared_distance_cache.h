@@ -0,0 +1,67 @@
+/**
+ * Pairwise squared distances shared by the Gaussian processes of a mixture
+ */
+
+#pragma once
+
+#include <Eigen/Dense>
+
+namespace sampling {
+namespace modeling {
+
+// Working set of one prediction tile (basis x tile block)
+const size_t KPredictionTileBytes = 1 << 20;
+const int KMinPredictionTileSize = 32;
+
+Eigen::MatrixXd SquaredDistance(const Eigen::MatrixXd &x1,
+                                const Eigen::MatrixXd &x2);
+
+/// RBF kernels of all experts and gating GPs are elementwise maps of the same
+/// squared distances, so those are computed here once per update instead of
+/// once per GP. The basis is the training inputs for exact GPs and the
+/// inducing points once the sparse approximation is enabled.
+class SquaredDistanceCache {
+ public:
+  SquaredDistanceCache();
+
+  /// Extends the cached distances in O(n * m) when x_train only appends m
+  /// rows to the previous call, recomputes them otherwise.
+  void UpdateTrain(const Eigen::MatrixXd &x_train);
+
+  /// Switches the basis to the inducing points. The train x train distances
+  /// are dropped.
+  void SetInducingPoints(const Eigen::MatrixXd &inducing_points);
+
+  bool IsSparse() const;
+
+  int GetTrainSize() const;
+
+  /// Bumped whenever the cached distances are recomputed rather than
+  /// extended, so that factors built on them can tell they are stale.
+  int GetGeneration() const;
+
+  /// Basis x train squared distances
+  const Eigen::MatrixXd &GetBasisTrain() const;
+
+  /// Basis x basis squared distances, same as GetBasisTrain for exact GPs
+  const Eigen::MatrixXd &GetBasisBasis() const;
+
+  Eigen::MatrixXd ComputeBasisTest(const Eigen::MatrixXd &x_test) const;
+
+  /// Number of test locations per tile so that one basis x tile block fits
+  /// in KPredictionTileBytes.
+  int PredictionTileSize() const;
+
+ private:
+  Eigen::MatrixXd x_train_;
+
+  Eigen::MatrixXd inducing_points_;
+
+  Eigen::MatrixXd basis_train_;
+
+  Eigen::MatrixXd basis_basis_;
+
+  int generation_;
+};
+}  // namespace modeling
+}  // namespace sampling
@@ -1,25 +0,0 @@
-import numpy as np
-import matplotlib.pyplot as plt
-
-from matplotlib import cm
-from mpl_toolkits.mplot3d import Axes3D
-
-def plot_gp(mu, cov, X, X_train=None, Y_train=None, samples=[]):
-    X = X.ravel()
-    mu = mu.ravel()
-    uncertainty = 1.96 * np.sqrt(np.diag(cov))
-    
-    plt.fill_between(X, mu + uncertainty, mu - uncertainty, alpha=0.1)
-    plt.plot(X, mu, label='Mean')
-    for i, sample in enumerate(samples):
-        plt.plot(X, sample)
-    if X_train is not None:
-        plt.plot(X_train, Y_train, 'rx')
-    plt.legend()
-    plt.show()
-
-def plot_gp_2D(gx, gy, mu, X_train, Y_train, title, i):
-    ax = plt.gcf().add_subplot(1, 2, i, projection='3d')
-    ax.plot_surface(gx, gy, mu.reshape(gx.shape), cmap=cm.coolwarm, linewidth=0, alpha=0.2, antialiased=False)
-    ax.scatter(X_train[:,0], X_train[:,1], Y_train, c=Y_train, cmap=cm.coolwarm)
-    ax.set_title(title)
\ No newline at end of file
@@ -0,0 +1,395 @@
+#include "sampling_modeling/gaussian_process.h"
+
+#include <ros/ros.h>
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <limits>
+#include <vector>
+
+namespace sampling {
+namespace modeling {
+
+RBFKernel::RBFKernel(const double &length_scale, const double &sigma_f)
+    : length_scale_(length_scale), sigma_f_(sigma_f) {}
+
+Eigen::MatrixXd RBFKernel::Compute(const Eigen::MatrixXd &sqdist) const {
+  return ComputeKernel(sqdist, length_scale_, sigma_f_);
+}
+
+Eigen::MatrixXd RBFKernel::ComputeKernel(const Eigen::MatrixXd &sqdist,
+                                         const double &length_scale,
+                                         const double &sigma_f) {
+  return sigma_f * sigma_f *
+         (-0.5 / (length_scale * length_scale) * sqdist.array()).exp();
+}
+
+void RBFKernel::UpdateKernel(const double &length_scale,
+                             const double &sigma_f) {
+  length_scale_ = length_scale;
+  sigma_f_ = sigma_f;
+}
+
+double RBFKernel::GetLengthScale() const { return length_scale_; }
+
+double RBFKernel::GetSigmaF() const { return sigma_f_; }
+
+GaussianProcess::GaussianProcess(const double &length_scale,
+                                 const double &sigma_f, const double &sigma_y,
+                                 const double &noise_weight_tolerance)
+    : kernel_(length_scale, sigma_f),
+      sigma_y_(sigma_y),
+      noise_weight_tolerance_(noise_weight_tolerance),
+      distance_generation_(0),
+      num_factorized_(0),
+      is_sparse_(false),
+      is_factor_valid_(false) {}
+
+bool GaussianProcess::UpdateData(const SquaredDistanceCache &distance,
+                                 const Eigen::VectorXd &y_train,
+                                 const Eigen::VectorXd &noise_weight) {
+  if (distance.GetTrainSize() != y_train.size() ||
+      (noise_weight.size() != 0 && noise_weight.size() != y_train.size())) {
+    ROS_ERROR_STREAM("Gaussian process training data does NOT match!");
+    return false;
+  }
+  Eigen::VectorXd noise;
+  if (noise_weight.size() == 0) {
+    noise = Eigen::VectorXd::Constant(y_train.size(), sigma_y_ * sigma_y_);
+  } else {
+    noise = sigma_y_ * sigma_y_ / noise_weight.array();
+  }
+  noise.array() += KGaussianProcessJitter;
+
+  if (distance.IsSparse()) return UpdateSparseData(distance, y_train, noise);
+
+  const int num_cached = CachedSampleSize(distance, noise_weight, noise);
+  if (num_cached == 0) {
+    if (!FactorizeCovariance(distance, noise_weight, noise)) return false;
+  } else if (num_cached < y_train.size()) {
+    if (!ExtendCovarianceFactor(distance, noise_weight, noise) &&
+        !FactorizeCovariance(distance, noise_weight, noise))
+      return false;
+  } else {
+    ++factor_statistics_.reuses;
+  }
+
+  alpha_ = cholesky_.triangularView<Eigen::Lower>().solve(y_train);
+  cholesky_.transpose().triangularView<Eigen::Upper>().solveInPlace(alpha_);
+  return true;
+}
+
+bool GaussianProcess::PosteriorPredict(
+    const Eigen::MatrixXd &basis_test_sqdist, Eigen::VectorXd &mean,
+    Eigen::VectorXd &var) const {
+  if (!is_factor_valid_ || basis_test_sqdist.rows() != alpha_.size()) {
+    ROS_ERROR_STREAM("Gaussian process has no matching training data!");
+    return false;
+  }
+  const double prior_var = kernel_.GetSigmaF() * kernel_.GetSigmaF();
+  Eigen::MatrixXd k_basis_test = kernel_.Compute(basis_test_sqdist);
+  if (is_sparse_) {
+    // var = k** - |L_inducing^-1 k_inducing*|^2 + |L_B^-1 L_inducing^-1
+    // k_inducing*|^2
+    inducing_cholesky_.triangularView<Eigen::Lower>().solveInPlace(
+        k_basis_test);
+    mean.noalias() = k_basis_test.transpose() * alpha_;
+    var = (prior_var + KGaussianProcessJitter) -
+          k_basis_test.colwise().squaredNorm().transpose().array();
+    sparse_cholesky_.triangularView<Eigen::Lower>().solveInPlace(k_basis_test);
+    var += k_basis_test.colwise().squaredNorm().transpose();
+    return true;
+  }
+  mean.noalias() = k_basis_test.transpose() * alpha_;
+  // diag(K_test_test - K_train_test^T * K^-1 * K_train_test), with
+  // K^-1 = L^-T * L^-1, so only the column norms of L^-1 * K_train_test
+  // are needed
+  cholesky_.triangularView<Eigen::Lower>().solveInPlace(k_basis_test);
+  var = (prior_var + KGaussianProcessJitter) -
+        k_basis_test.colwise().squaredNorm().transpose().array();
+  return true;
+}
+
+bool GaussianProcess::OptimizeKernel(const Eigen::MatrixXd &train_sqdist,
+                                     const Eigen::VectorXd &y_train) {
+  Eigen::Vector2d theta(kernel_.GetLengthScale(), kernel_.GetSigmaF());
+  if (!std::isfinite(
+          MinimizeNegativeLogLikelihood(train_sqdist, y_train, theta)))
+    return false;
+  UpdateKernel(theta(0), theta(1));
+  return true;
+}
+
+double GaussianProcess::MinimizeNegativeLogLikelihood(
+    const Eigen::MatrixXd &train_sqdist, const Eigen::VectorXd &y_train,
+    Eigen::Vector2d &theta) const {
+  if (train_sqdist.rows() != y_train.size() ||
+      train_sqdist.cols() != y_train.size() || y_train.size() == 0) {
+    ROS_ERROR_STREAM("Invalid data for Gaussian process kernel optimization!");
+    return std::numeric_limits<double>::infinity();
+  }
+  const Eigen::Vector2d lower =
+      Eigen::Vector2d::Constant(std::log(KKernelMinHyperparam));
+  Eigen::Vector2d x = theta.cwiseMax(KKernelMinHyperparam).array().log();
+  Eigen::Vector2d gradient;
+  double nll = NegativeLogLikelihood(train_sqdist, y_train, x, gradient);
+  if (!std::isfinite(nll) || !gradient.allFinite()) {
+    ROS_WARN_STREAM("Gaussian process kernel optimization starts from an "
+                    "invalid point!");
+    return std::numeric_limits<double>::infinity();
+  }
+
+  std::deque<Eigen::Vector2d> s_history, y_history;
+  for (int iter = 0; iter < KKernelOptimizationMaxIteration; ++iter) {
+    if (gradient.norm() < KKernelOptimizationTolerance) break;
+
+    // Two-loop recursion for the quasi-Newton direction
+    Eigen::Vector2d direction = -gradient;
+    std::vector<double> rho(s_history.size()), a(s_history.size());
+    for (int k = int(s_history.size()) - 1; k >= 0; --k) {
+      rho[k] = 1.0 / y_history[k].dot(s_history[k]);
+      a[k] = rho[k] * s_history[k].dot(direction);
+      direction -= a[k] * y_history[k];
+    }
+    if (s_history.empty()) {
+      direction /= std::max(1.0, gradient.norm());
+    } else {
+      direction *= s_history.back().dot(y_history.back()) /
+                   y_history.back().squaredNorm();
+    }
+    for (size_t k = 0; k < s_history.size(); ++k) {
+      const double b = rho[k] * y_history[k].dot(direction);
+      direction += (a[k] - b) * s_history[k];
+    }
+    if (direction.dot(gradient) >= 0.0) direction = -gradient;
+
+    // Backtracking line search with the Armijo condition
+    Eigen::Vector2d x_new, gradient_new;
+    double nll_new = nll, step = 1.0;
+    bool accepted = false;
+    for (int k = 0; k < KLineSearchMaxIteration; ++k, step *= 0.5) {
+      x_new = (x + step * direction).cwiseMax(lower);
+      nll_new =
+          NegativeLogLikelihood(train_sqdist, y_train, x_new, gradient_new);
+      if (std::isfinite(nll_new) && gradient_new.allFinite() &&
+          nll_new <= nll + KLineSearchDecrease * gradient.dot(x_new - x)) {
+        accepted = true;
+        break;
+      }
+    }
+    if (!accepted) break;
+
+    const Eigen::Vector2d s_k = x_new - x;
+    const Eigen::Vector2d y_k = gradient_new - gradient;
+    if (s_k.dot(y_k) > std::numeric_limits<double>::epsilon()) {
+      s_history.push_back(s_k);
+      y_history.push_back(y_k);
+      if (int(s_history.size()) > KLBFGSMemory) {
+        s_history.pop_front();
+        y_history.pop_front();
+      }
+    }
+    const double decrease = nll - nll_new;
+    x = x_new;
+    gradient = gradient_new;
+    nll = nll_new;
+    if (decrease < KKernelOptimizationTolerance) break;
+  }
+  theta = x.array().exp();
+  return nll;
+}
+
+void GaussianProcess::UpdateKernel(const double &length_scale,
+                                   const double &sigma_f) {
+  if (length_scale == kernel_.GetLengthScale() &&
+      sigma_f == kernel_.GetSigmaF())
+    return;
+  kernel_.UpdateKernel(length_scale, sigma_f);
+  is_factor_valid_ = false;
+}
+
+const RBFKernel &GaussianProcess::GetKernel() const { return kernel_; }
+
+const FactorStatistics &GaussianProcess::GetFactorStatistics() const {
+  return factor_statistics_;
+}
+
+bool GaussianProcess::UpdateSparseData(const SquaredDistanceCache &distance,
+                                       const Eigen::VectorXd &y_train,
+                                       const Eigen::VectorXd &noise) {
+  // Projection on the inducing points only depends on the kernel and the
+  // training inputs, so appended samples only add columns
+  int num_cached = num_factorized_;
+  if (!is_factor_valid_ || !is_sparse_ ||
+      distance_generation_ != distance.GetGeneration() ||
+      num_cached > y_train.size())
+    num_cached = 0;
+
+  const Eigen::MatrixXd &inducing_train = distance.GetBasisTrain();
+  if (num_cached == 0) {
+    is_factor_valid_ = false;
+    Eigen::MatrixXd k_inducing = kernel_.Compute(distance.GetBasisBasis());
+    k_inducing.diagonal().array() += KGaussianProcessJitter;
+    Eigen::LLT<Eigen::MatrixXd> llt(k_inducing);
+    if (llt.info() != Eigen::Success) {
+      ROS_ERROR_STREAM("Failed to factorize inducing point covariance!");
+      return false;
+    }
+    inducing_cholesky_ = llt.matrixL();
+    inducing_projection_ = kernel_.Compute(inducing_train);
+    inducing_cholesky_.triangularView<Eigen::Lower>().solveInPlace(
+        inducing_projection_);
+  } else if (num_cached < y_train.size()) {
+    const int num_new = y_train.size() - num_cached;
+    Eigen::MatrixXd projection_new =
+        kernel_.Compute(inducing_train.rightCols(num_new));
+    inducing_cholesky_.triangularView<Eigen::Lower>().solveInPlace(
+        projection_new);
+    inducing_projection_.conservativeResize(Eigen::NoChange, y_train.size());
+    inducing_projection_.rightCols(num_new) = projection_new;
+  }
+  is_sparse_ = true;
+  distance_generation_ = distance.GetGeneration();
+  num_factorized_ = y_train.size();
+  cholesky_.resize(0, 0);
+
+  // B = I + V * noise^-1 * V^T
+  const Eigen::VectorXd inverse_noise = noise.cwiseInverse();
+  const Eigen::MatrixXd scaled_projection =
+      inducing_projection_ * inverse_noise.cwiseSqrt().asDiagonal();
+  const int num_inducing = inducing_projection_.rows();
+  Eigen::MatrixXd b = Eigen::MatrixXd::Identity(num_inducing, num_inducing);
+  b.selfadjointView<Eigen::Lower>().rankUpdate(scaled_projection);
+  Eigen::LLT<Eigen::MatrixXd> llt(b);
+  if (llt.info() != Eigen::Success) {
+    ROS_ERROR_STREAM("Failed to factorize sparse Gaussian process covariance!");
+    return false;
+  }
+  sparse_cholesky_ = llt.matrixL();
+  is_factor_valid_ = true;
+  // alpha = L_B^-T * L_B^-1 * V * noise^-1 * y, so that mean = (L_inducing^-1
+  // k_inducing*)^T * alpha
+  alpha_ = inducing_projection_ * y_train.cwiseProduct(inverse_noise);
+  sparse_cholesky_.triangularView<Eigen::Lower>().solveInPlace(alpha_);
+  sparse_cholesky_.transpose().triangularView<Eigen::Upper>().solveInPlace(
+      alpha_);
+  return true;
+}
+
+int GaussianProcess::CachedSampleSize(const SquaredDistanceCache &distance,
+                                      const Eigen::VectorXd &noise_weight,
+                                      const Eigen::VectorXd &noise) const {
+  const int num_cached = num_factorized_;
+  if (!is_factor_valid_ || is_sparse_ || num_cached == 0 ||
+      distance_generation_ != distance.GetGeneration() ||
+      num_cached > noise.size())
+    return 0;
+  // Rows keep the noise they were factorized with, so the factor stays exact
+  // for weights no further than the tolerance from the current ones
+  if (noise_weight_tolerance_ > 0.0 && noise_weight.size() > 0 &&
+      noise_weight_.size() == num_cached) {
+    const double max_change =
+        (noise_weight.head(num_cached) - noise_weight_).cwiseAbs().maxCoeff();
+    return max_change <= noise_weight_tolerance_ ? num_cached : 0;
+  }
+  if (noise.head(num_cached) != noise_) return 0;
+  return num_cached;
+}
+
+bool GaussianProcess::FactorizeCovariance(const SquaredDistanceCache &distance,
+                                          const Eigen::VectorXd &noise_weight,
+                                          const Eigen::VectorXd &noise) {
+  is_factor_valid_ = false;
+  Eigen::MatrixXd k_train_train = kernel_.Compute(distance.GetBasisTrain());
+  k_train_train.diagonal() += noise;
+  Eigen::LLT<Eigen::MatrixXd> llt(k_train_train);
+  if (llt.info() != Eigen::Success) {
+    ROS_ERROR_STREAM("Failed to factorize Gaussian process covariance!");
+    return false;
+  }
+  cholesky_ = llt.matrixL();
+  noise_ = noise;
+  noise_weight_ = noise_weight;
+  is_sparse_ = false;
+  distance_generation_ = distance.GetGeneration();
+  num_factorized_ = noise.size();
+  is_factor_valid_ = true;
+  ++factor_statistics_.factorizations;
+  return true;
+}
+
+bool GaussianProcess::ExtendCovarianceFactor(
+    const SquaredDistanceCache &distance, const Eigen::VectorXd &noise_weight,
+    const Eigen::VectorXd &noise) {
+  // [K11 K12; K21 K22] = [L11 0; L21 L22] * [L11 0; L21 L22]^T
+  // L21 = (L11^-1 * K12)^T, L22 = chol(K22 - L21 * L21^T)
+  const int num_cached = num_factorized_;
+  const int num_new = noise.size() - num_cached;
+  const Eigen::MatrixXd &train_sqdist = distance.GetBasisTrain();
+  const Eigen::MatrixXd l21 =
+      cholesky_.triangularView<Eigen::Lower>()
+          .solve(kernel_.Compute(
+              train_sqdist.topRightCorner(num_cached, num_new)))
+          .transpose();
+  Eigen::MatrixXd schur =
+      kernel_.Compute(train_sqdist.bottomRightCorner(num_new, num_new));
+  schur.diagonal() += noise.tail(num_new);
+  schur.noalias() -= l21 * l21.transpose();
+  Eigen::LLT<Eigen::MatrixXd> llt(schur);
+  if (llt.info() != Eigen::Success) {
+    ROS_WARN_STREAM("Incremental Cholesky update failed, refactorizing!");
+    return false;
+  }
+
+  cholesky_.conservativeResize(num_cached + num_new, num_cached + num_new);
+  cholesky_.topRightCorner(num_cached, num_new).setZero();
+  cholesky_.bottomLeftCorner(num_new, num_cached) = l21;
+  cholesky_.bottomRightCorner(num_new, num_new) = llt.matrixL();
+  // Existing rows keep the noise of the factor
+  noise_.conservativeResize(noise.size());
+  noise_.tail(num_new) = noise.tail(num_new);
+  if (noise_weight.size() > 0 && noise_weight_.size() == num_cached) {
+    noise_weight_.conservativeResize(noise_weight.size());
+    noise_weight_.tail(num_new) = noise_weight.tail(num_new);
+  } else {
+    noise_weight_ = noise_weight;
+  }
+  num_factorized_ = noise.size();
+  ++factor_statistics_.extensions;
+  return true;
+}
+
+double GaussianProcess::NegativeLogLikelihood(
+    const Eigen::MatrixXd &train_sqdist, const Eigen::VectorXd &y_train,
+    const Eigen::Vector2d &log_theta, Eigen::Vector2d &gradient) const {
+  const double length_scale = std::exp(log_theta(0));
+  const double sigma_f = std::exp(log_theta(1));
+  const Eigen::MatrixXd k_f =
+      RBFKernel::ComputeKernel(train_sqdist, length_scale, sigma_f);
+  Eigen::MatrixXd k = k_f;
+  k.diagonal().array() += sigma_y_ * sigma_y_ + KGaussianProcessJitter;
+  Eigen::LLT<Eigen::MatrixXd> llt(k);
+  if (llt.info() != Eigen::Success)
+    return std::numeric_limits<double>::infinity();
+  const Eigen::VectorXd alpha = llt.solve(y_train);
+
+  // d nll / d theta = 0.5 * tr((K^-1 - alpha * alpha^T) * dK / d theta), with
+  // dK / d log(l) = K_f .* D / l^2 and dK / d log(sigma_f) = 2 * K_f. Both
+  // matrices are symmetric, so the trace is an elementwise sum.
+  Eigen::MatrixXd inner =
+      Eigen::MatrixXd::Identity(y_train.size(), y_train.size());
+  llt.solveInPlace(inner);
+  inner.noalias() -= alpha * alpha.transpose();
+  const Eigen::MatrixXd inner_k_f = inner.cwiseProduct(k_f);
+  gradient(0) = 0.5 * inner_k_f.cwiseProduct(train_sqdist).sum() /
+                (length_scale * length_scale);
+  gradient(1) = inner_k_f.sum();
+
+  return llt.matrixLLT().diagonal().array().log().sum() +
+         0.5 * y_train.dot(alpha) +
+         0.5 * double(y_train.size()) * std::log(2.0 * M_PI);
+}
+
+}  // namespace modeling
+}  // namespace sampling
@@ -0,0 +1,339 @@
+#include "sampling_modeling/mixture_gaussian_process.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+
+namespace sampling {
+namespace modeling {
+
+std::unique_ptr<MixtureGaussianProcess>
+MixtureGaussianProcess::MakeUniqueFromRosParam(ros::NodeHandle &ph) {
+  MixtureGaussianProcessParams params;
+  if (!params.LoadFromRosParams(ph)) {
+    ROS_ERROR_STREAM("Failed to load mixture Gaussian process parameters!");
+    return nullptr;
+  }
+  return std::unique_ptr<MixtureGaussianProcess>(
+      new MixtureGaussianProcess(params));
+}
+
+MixtureGaussianProcess::MixtureGaussianProcess(
+    const MixtureGaussianProcessParams &params)
+    : params_(params),
+      thread_pool_(new utils::ThreadPool(
+          std::min(params.num_threads > 0
+                       ? params.num_threads
+                       : int(std::thread::hardware_concurrency()),
+                   2 * params.num_gp *
+                       (1 + params.kernel_optimization_restarts)))) {
+  gps_.reserve(params_.num_gp);
+  gating_gps_.reserve(params_.num_gp);
+  for (int i = 0; i < params_.num_gp; ++i) {
+    const GaussianProcessParams &gp = params_.modeling_gp_params[i];
+    gps_.emplace_back(gp.length_scale, gp.sigma_f, gp.sigma_y,
+                      params_.em_epsilon);
+    const GaussianProcessParams &gating = params_.gating_gp_params[i];
+    gating_gps_.emplace_back(gating.length_scale, gating.sigma_f,
+                             gating.sigma_y);
+  }
+}
+
+bool MixtureGaussianProcess::SetTestLocations(
+    const Eigen::MatrixXd &test_locations) {
+  if (test_locations.rows() == 0) {
+    ROS_ERROR_STREAM("Empty test locations for mixture Gaussian process!");
+    return false;
+  }
+  const int num_inducing =
+      std::min(params_.num_inducing_points, int(test_locations.rows()));
+  if (num_inducing <= 0) return true;
+
+  // Farthest point sampling keeps the inducing points spread over the map
+  inducing_points_.resize(num_inducing, test_locations.cols());
+  Eigen::VectorXd min_distance =
+      Eigen::VectorXd::Constant(test_locations.rows(),
+                                std::numeric_limits<double>::infinity());
+  Eigen::MatrixXd::Index next = 0;
+  for (int i = 0; i < num_inducing; ++i) {
+    inducing_points_.row(i) = test_locations.row(next);
+    min_distance = min_distance.cwiseMin(
+        (test_locations.rowwise() - test_locations.row(next))
+            .rowwise()
+            .squaredNorm());
+    min_distance.maxCoeff(&next);
+  }
+  return true;
+}
+
+bool MixtureGaussianProcess::AddSample(const Eigen::MatrixXd &x,
+                                       const Eigen::VectorXd &y) {
+  if (x.rows() != y.size() || y.size() == 0) {
+    ROS_ERROR_STREAM("Invalid samples for mixture Gaussian process!");
+    return false;
+  }
+  Eigen::MatrixXd new_p;
+  if (!InitialResponsibility(x, new_p)) return false;
+
+  const int num_samples = x_train_.rows();
+  x_train_.conservativeResize(num_samples + x.rows(), x.cols());
+  x_train_.bottomRows(x.rows()) = x;
+  y_train_.conservativeResize(num_samples + y.size());
+  y_train_.tail(y.size()) = y;
+  p_.conservativeResize(num_samples + y.size(), params_.num_gp);
+  p_.bottomRows(y.size()) = new_p;
+  distance_.UpdateTrain(x_train_);
+
+  if (!distance_.IsSparse() && params_.sparse_gp_threshold > 0 &&
+      GetSampleCount() > params_.sparse_gp_threshold)
+    return EnableSparseApproximation();
+  return true;
+}
+
+bool MixtureGaussianProcess::OptimizeModel() {
+  const bool optimize_kernel =
+      params_.online_kernel_optimization &&
+      GetSampleCount() <= params_.online_optimization_threshold;
+  if (!EMOptimize()) return false;
+  if (optimize_kernel && !OptimizeKernels()) return false;
+  return true;
+}
+
+bool MixtureGaussianProcess::Predict(const Eigen::MatrixXd &x_test,
+                                     std::vector<double> &mean,
+                                     std::vector<double> &var) {
+  // Gating GPs and experts are independent, run all of them at once
+  if (!ForEachGP(2 * params_.num_gp, [&](int task) {
+        const int i = task % params_.num_gp;
+        return task < params_.num_gp
+                   ? gating_gps_[i].UpdateData(distance_, p_.col(i),
+                                               Eigen::VectorXd())
+                   : gps_[i].UpdateData(distance_, y_train_, p_.col(i));
+      }))
+    return false;
+
+  Eigen::MatrixXd gating(x_test.rows(), params_.num_gp);
+  Eigen::MatrixXd pred_mean(x_test.rows(), params_.num_gp);
+  Eigen::MatrixXd pred_var(x_test.rows(), params_.num_gp);
+  const int tile_size = distance_.PredictionTileSize();
+  for (int start = 0; start < x_test.rows(); start += tile_size) {
+    const int size = std::min(tile_size, int(x_test.rows()) - start);
+    const Eigen::MatrixXd basis_test_sqdist =
+        distance_.ComputeBasisTest(x_test.middleRows(start, size));
+    if (!ForEachGP(2 * params_.num_gp, [&](int task) {
+          const int i = task % params_.num_gp;
+          Eigen::VectorXd gp_mean, gp_var;
+          if (task < params_.num_gp) {
+            if (!gating_gps_[i].PosteriorPredict(basis_test_sqdist, gp_mean,
+                                                 gp_var))
+              return false;
+            gating.col(i).segment(start, size) = gp_mean;
+          } else {
+            if (!gps_[i].PosteriorPredict(basis_test_sqdist, gp_mean, gp_var))
+              return false;
+            pred_mean.col(i).segment(start, size) = gp_mean;
+            pred_var.col(i).segment(start, size) = gp_var;
+          }
+          return true;
+        }))
+      return false;
+  }
+
+  const Eigen::VectorXd mixture_mean =
+      pred_mean.cwiseProduct(gating).rowwise().sum();
+  const Eigen::VectorXd mixture_var =
+      pred_var.cwiseProduct(gating).rowwise().sum();
+  mean.assign(mixture_mean.data(), mixture_mean.data() + mixture_mean.size());
+  var.assign(mixture_var.data(), mixture_var.data() + mixture_var.size());
+  return true;
+}
+
+int MixtureGaussianProcess::GetSampleCount() const { return y_train_.size(); }
+
+const EMStatistics &MixtureGaussianProcess::GetEMStatistics() const {
+  return em_statistics_;
+}
+
+bool MixtureGaussianProcess::EnableSparseApproximation() {
+  if (inducing_points_.rows() == 0) {
+    ROS_WARN_STREAM("No test locations to select inducing points from, "
+                    "keeping exact Gaussian processes!");
+    return true;
+  }
+  distance_.SetInducingPoints(inducing_points_);
+  ROS_INFO_STREAM("Mixture Gaussian process switched to "
+                  << inducing_points_.rows() << " inducing points at "
+                  << GetSampleCount() << " samples!");
+  return true;
+}
+
+bool MixtureGaussianProcess::InitialResponsibility(const Eigen::MatrixXd &x,
+                                                   Eigen::MatrixXd &p) {
+  if (GetSampleCount() == 0) {
+    p = (Eigen::MatrixXd::Random(x.rows(), params_.num_gp).array() + 1.0) *
+            0.5 +
+        KResponsibilityFloor;
+  } else {
+    // Gating GPs are usually still factorized from the last update, so this
+    // is a single prediction at the new locations
+    p.resize(x.rows(), params_.num_gp);
+    const Eigen::MatrixXd basis_x_sqdist = distance_.ComputeBasisTest(x);
+    if (!ForEachGP(params_.num_gp, [&](int i) {
+          Eigen::VectorXd mean, var;
+          if (!gating_gps_[i].UpdateData(distance_, p_.col(i),
+                                         Eigen::VectorXd()) ||
+              !gating_gps_[i].PosteriorPredict(basis_x_sqdist, mean, var))
+            return false;
+          p.col(i) = mean.cwiseMax(0.0);
+          return true;
+        }))
+      return false;
+    p.array() += KResponsibilityFloor;
+  }
+  p = p.array().colwise() / p.rowwise().sum().array();
+  return true;
+}
+
+bool MixtureGaussianProcess::Expectation(const Eigen::MatrixXd &pred_mean,
+                                         const Eigen::MatrixXd &pred_var) {
+  Eigen::MatrixXd likelihood(y_train_.size(), params_.num_gp);
+  for (int i = 0; i < params_.num_gp; ++i) {
+    // Each expert is scored with a normal of its predicted mean and the
+    // standard deviation of its predicted variance over the training set
+    const double var_mean = pred_var.col(i).mean();
+    const double scale = std::max(
+        std::sqrt((pred_var.col(i).array() - var_mean).square().mean()),
+        KResponsibilityFloor);
+    likelihood.col(i) =
+        (-0.5 * ((y_train_ - pred_mean.col(i)) / scale).array().square())
+            .exp() /
+        (scale * std::sqrt(2.0 * M_PI));
+  }
+  p_ = p_.cwiseProduct(likelihood).array() + KResponsibilityFloor;
+  p_ = p_.array().colwise() / p_.rowwise().sum().array();
+  return true;
+}
+
+bool MixtureGaussianProcess::Maximization(Eigen::MatrixXd &pred_mean,
+                                          Eigen::MatrixXd &pred_var) {
+  pred_mean.resize(y_train_.size(), params_.num_gp);
+  pred_var.resize(y_train_.size(), params_.num_gp);
+  return ForEachGP(params_.num_gp, [&](int i) {
+    Eigen::VectorXd mean, var;
+    if (!gps_[i].UpdateData(distance_, y_train_, p_.col(i)) ||
+        !gps_[i].PosteriorPredict(distance_.GetBasisTrain(), mean, var))
+      return false;
+    pred_mean.col(i) = mean;
+    pred_var.col(i) = var;
+    return true;
+  });
+}
+
+bool MixtureGaussianProcess::EMOptimize() {
+  if (y_train_.size() == 0) {
+    ROS_ERROR_STREAM("No sample for mixture Gaussian process optimization!");
+    return false;
+  }
+  em_statistics_ = EMStatistics();
+  Eigen::MatrixXd pred_mean, pred_var;
+  while (em_statistics_.iterations < params_.em_max_iteration) {
+    const Eigen::MatrixXd prev_p = p_;
+    if (!Maximization(pred_mean, pred_var)) return false;
+    if (!Expectation(pred_mean, pred_var)) return false;
+    ++em_statistics_.iterations;
+    em_statistics_.diff_p = (p_ - prev_p).cwiseAbs().maxCoeff();
+    if (em_statistics_.diff_p <= params_.em_epsilon) {
+      em_statistics_.converged = true;
+      break;
+    }
+  }
+  return true;
+}
+
+bool MixtureGaussianProcess::OptimizeKernels() {
+  // The sparse mode does not keep train x train distances, fit the kernels
+  // on a strided subset of the samples instead of all of them
+  const bool is_sparse = distance_.IsSparse();
+  Eigen::MatrixXd sparse_train_sqdist;
+  Eigen::VectorXd sparse_y_train;
+  Eigen::MatrixXd sparse_p;
+  if (is_sparse) {
+    const int num_samples =
+        std::min(params_.num_inducing_points, GetSampleCount());
+    Eigen::MatrixXd x_subset(num_samples, x_train_.cols());
+    sparse_y_train.resize(num_samples);
+    sparse_p.resize(num_samples, p_.cols());
+    for (int j = 0; j < num_samples; ++j) {
+      const int row = int(double(j) * GetSampleCount() / num_samples);
+      x_subset.row(j) = x_train_.row(row);
+      sparse_y_train(j) = y_train_(row);
+      sparse_p.row(j) = p_.row(row);
+    }
+    sparse_train_sqdist = SquaredDistance(x_subset, x_subset);
+  }
+  const Eigen::MatrixXd &train_sqdist =
+      is_sparse ? sparse_train_sqdist : distance_.GetBasisTrain();
+  const Eigen::VectorXd &y_train = is_sparse ? sparse_y_train : y_train_;
+  const Eigen::MatrixXd &p = is_sparse ? sparse_p : p_;
+
+  // Experts fit the samples, gating GPs fit the responsibilities, all of them
+  // independently. Start 0 of each GP is its current kernel.
+  const int num_starts = 1 + params_.kernel_optimization_restarts;
+  const int num_tasks = 2 * params_.num_gp * num_starts;
+  std::vector<Eigen::Vector2d> thetas(num_tasks);
+  std::vector<double> nlls(num_tasks);
+  ForEachGP(num_tasks, [&](int task) {
+    const int gp_index = task / num_starts;
+    const int start = task % num_starts;
+    const int i = gp_index % params_.num_gp;
+    const bool is_expert = gp_index < params_.num_gp;
+    const GaussianProcess &gp = is_expert ? gps_[i] : gating_gps_[i];
+    const RBFKernel &kernel = gp.GetKernel();
+    thetas[task] << kernel.GetLengthScale(), kernel.GetSigmaF();
+    if (start > 0) {
+      std::mt19937 generator(task);
+      std::uniform_real_distribution<double> perturbation(
+          -KKernelRestartLogRange, KKernelRestartLogRange);
+      thetas[task](0) *= std::exp(perturbation(generator));
+      thetas[task](1) *= std::exp(perturbation(generator));
+    }
+    nlls[task] = gp.MinimizeNegativeLogLikelihood(
+        train_sqdist, is_expert ? y_train : Eigen::VectorXd(p.col(i)),
+        thetas[task]);
+    return true;
+  });
+
+  for (int gp_index = 0; gp_index < 2 * params_.num_gp; ++gp_index) {
+    const int i = gp_index % params_.num_gp;
+    const bool is_expert = gp_index < params_.num_gp;
+    const auto first = nlls.begin() + gp_index * num_starts;
+    const auto best = std::min_element(first, first + num_starts);
+    if (!std::isfinite(*best)) {
+      ROS_WARN_STREAM("Failed to optimize kernel of "
+                      << (is_expert ? "modeling" : "gating") << " gp " << i);
+      continue;
+    }
+    const Eigen::Vector2d &theta = thetas[best - nlls.begin()];
+    GaussianProcess &gp = is_expert ? gps_[i] : gating_gps_[i];
+    const Eigen::Vector2d current(gp.GetKernel().GetLengthScale(),
+                                  gp.GetKernel().GetSigmaF());
+    if (((theta - current).array().abs() <=
+         KKernelUpdateRelativeTolerance * current.array())
+            .all())
+      continue;
+    gp.UpdateKernel(theta(0), theta(1));
+  }
+  return true;
+}
+
+bool MixtureGaussianProcess::ForEachGP(const int &num_tasks,
+                                       const std::function<bool(int)> &task) {
+  std::vector<char> success(num_tasks, false);
+  thread_pool_->ParallelFor(num_tasks, [&](int i) { success[i] = task(i); });
+  return std::all_of(success.begin(), success.end(),
+                     [](const char &result) { return bool(result); });
+}
+
+}  // namespace modeling
+}  // namespace sampling
@@ -0,0 +1,75 @@
+#include "sampling_modeling/mixture_gaussian_process_params.h"
+
+#include <ros/ros.h>
+
+namespace sampling {
+namespace modeling {
+
+GaussianProcessParams::GaussianProcessParams() {}
+
+bool GaussianProcessParams::LoadFromVector(const std::vector<double> &param) {
+  if (param.size() != 3) {
+    ROS_ERROR_STREAM(
+        "Gaussian process kernel requires [length_scale, sigma_f, sigma_y]!");
+    return false;
+  }
+  length_scale = param[0];
+  sigma_f = param[1];
+  sigma_y = param[2];
+  return true;
+}
+
+MixtureGaussianProcessParams::MixtureGaussianProcessParams() {}
+
+bool MixtureGaussianProcessParams::LoadFromRosParams(ros::NodeHandle &ph) {
+  ph.param<int>("num_gp", num_gp, KNumGP);
+  if (num_gp <= 0) {
+    ROS_ERROR_STREAM("Invalid number of Gaussian processes : " << num_gp);
+    return false;
+  }
+
+  modeling_gp_params.resize(num_gp);
+  gating_gp_params.resize(num_gp);
+  for (int i = 0; i < num_gp; ++i) {
+    std::vector<double> modeling_gp_param, gating_gp_param;
+    ph.param<std::vector<double>>("modeling_gp_" + std::to_string(i) +
+                                      "_kernel",
+                                  modeling_gp_param, KDefaultKernelParam);
+    ph.param<std::vector<double>>("gating_gp_" + std::to_string(i) + "_kernel",
+                                  gating_gp_param, KDefaultKernelParam);
+    if (!modeling_gp_params[i].LoadFromVector(modeling_gp_param)) {
+      ROS_ERROR_STREAM("Error loading modeling gp " << i << " kernel!");
+      return false;
+    }
+    if (!gating_gp_params[i].LoadFromVector(gating_gp_param)) {
+      ROS_ERROR_STREAM("Error loading gating gp " << i << " kernel!");
+      return false;
+    }
+  }
+
+  ph.param<double>("EM_epsilon", em_epsilon, KEMEpsilon);
+  ph.param<int>("EM_max_iteration", em_max_iteration, KEMMaxIteration);
+  ph.param<bool>("online_kernel_optimization", online_kernel_optimization,
+                 true);
+  ph.param<int>("online_optimization_threshold", online_optimization_threshold,
+                KOnlineOptimizationThreshold);
+  ph.param<int>("kernel_optimization_restarts", kernel_optimization_restarts,
+                KKernelOptimizationRestarts);
+  if (kernel_optimization_restarts < 0) {
+    ROS_ERROR_STREAM("Invalid number of kernel optimization restarts : "
+                     << kernel_optimization_restarts);
+    return false;
+  }
+  ph.param<int>("sparse_gp_threshold", sparse_gp_threshold, KSparseGPThreshold);
+  ph.param<int>("num_inducing_points", num_inducing_points,
+                KNumInducingPoints);
+  ph.param<int>("num_threads", num_threads, KModelingThreads);
+  if (sparse_gp_threshold > 0 && num_inducing_points <= 0) {
+    ROS_ERROR_STREAM("Sparse Gaussian process requires inducing points!");
+    return false;
+  }
+  return true;
+}
+
+}  // namespace modeling
+}  // namespace sampling
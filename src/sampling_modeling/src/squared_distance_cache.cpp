@@ -0,0 +1,89 @@
+#include "sampling_modeling/squared_distance_cache.h"
+
+#include <algorithm>
+
+namespace sampling {
+namespace modeling {
+
+Eigen::MatrixXd SquaredDistance(const Eigen::MatrixXd &x1,
+                                const Eigen::MatrixXd &x2) {
+  Eigen::MatrixXd sqdist = (-2.0 * x1 * x2.transpose()).colwise() +
+                           x1.rowwise().squaredNorm();
+  sqdist.rowwise() += x2.rowwise().squaredNorm().transpose();
+  return sqdist.cwiseMax(0.0);
+}
+
+SquaredDistanceCache::SquaredDistanceCache() : generation_(0) {}
+
+void SquaredDistanceCache::UpdateTrain(const Eigen::MatrixXd &x_train) {
+  const int num_cached = x_train_.rows();
+  const bool is_append = num_cached > 0 && num_cached <= x_train.rows() &&
+                         x_train_.cols() == x_train.cols() &&
+                         x_train.topRows(num_cached) == x_train_;
+  if (!is_append) {
+    basis_train_ = IsSparse() ? SquaredDistance(inducing_points_, x_train)
+                              : SquaredDistance(x_train, x_train);
+    x_train_ = x_train;
+    ++generation_;
+    return;
+  }
+
+  const int num_new = x_train.rows() - num_cached;
+  if (num_new == 0) return;
+  const Eigen::MatrixXd x_new = x_train.bottomRows(num_new);
+  if (IsSparse()) {
+    basis_train_.conservativeResize(Eigen::NoChange, x_train.rows());
+    basis_train_.rightCols(num_new) = SquaredDistance(inducing_points_, x_new);
+  } else {
+    const Eigen::MatrixXd cached_new = SquaredDistance(x_train_, x_new);
+    basis_train_.conservativeResize(x_train.rows(), x_train.rows());
+    basis_train_.topRightCorner(num_cached, num_new) = cached_new;
+    basis_train_.bottomLeftCorner(num_new, num_cached) =
+        cached_new.transpose();
+    basis_train_.bottomRightCorner(num_new, num_new) =
+        SquaredDistance(x_new, x_new);
+  }
+  x_train_ = x_train;
+}
+
+void SquaredDistanceCache::SetInducingPoints(
+    const Eigen::MatrixXd &inducing_points) {
+  inducing_points_ = inducing_points;
+  basis_basis_ = SquaredDistance(inducing_points_, inducing_points_);
+  if (x_train_.rows() > 0)
+    basis_train_ = SquaredDistance(inducing_points_, x_train_);
+  else
+    basis_train_.resize(inducing_points_.rows(), 0);
+  ++generation_;
+}
+
+bool SquaredDistanceCache::IsSparse() const {
+  return inducing_points_.rows() > 0;
+}
+
+int SquaredDistanceCache::GetTrainSize() const { return x_train_.rows(); }
+
+int SquaredDistanceCache::GetGeneration() const { return generation_; }
+
+const Eigen::MatrixXd &SquaredDistanceCache::GetBasisTrain() const {
+  return basis_train_;
+}
+
+const Eigen::MatrixXd &SquaredDistanceCache::GetBasisBasis() const {
+  return IsSparse() ? basis_basis_ : basis_train_;
+}
+
+Eigen::MatrixXd SquaredDistanceCache::ComputeBasisTest(
+    const Eigen::MatrixXd &x_test) const {
+  return SquaredDistance(IsSparse() ? inducing_points_ : x_train_, x_test);
+}
+
+int SquaredDistanceCache::PredictionTileSize() const {
+  const int basis_size = IsSparse() ? inducing_points_.rows() : x_train_.rows();
+  const size_t column_bytes = sizeof(double) * std::max(1, basis_size);
+  return std::max(KMinPredictionTileSize,
+                  int(KPredictionTileBytes / column_bytes));
+}
+
+}  // namespace modeling
+}  // namespace sampling
@@ -0,0 +1,126 @@
+#include <gtest/gtest.h>
+
+#include <Eigen/Dense>
+#include <cstdlib>
+
+#include "sampling_modeling/gaussian_process.h"
+#include "sampling_modeling/squared_distance_cache.h"
+
+namespace sampling {
+namespace modeling {
+
+const int KFixtureSamples = 120;
+const int KFixtureAppended = 30;
+const double KFixtureTolerance = 1e-8;
+
+class GaussianProcessTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    srand(7);
+    x_ = Eigen::MatrixXd::Random(KFixtureSamples + KFixtureAppended, 2) * 3.0;
+    y_ = (x_.col(0).array().sin() * x_.col(1).array().cos()).matrix();
+    weight_ = (Eigen::ArrayXd::Random(y_.size()) * 0.4 + 0.5).matrix();
+    x_test_ = Eigen::MatrixXd::Random(50, 2) * 3.0;
+  }
+
+  /// Posterior at x_test_ of gp after updates on the first num_samples
+  void Predict(GaussianProcess &gp, const SquaredDistanceCache &distance,
+               const int &num_samples, Eigen::VectorXd &mean,
+               Eigen::VectorXd &var) {
+    const Eigen::MatrixXd basis_test_sqdist =
+        distance.ComputeBasisTest(x_test_);
+    ASSERT_EQ(basis_test_sqdist.rows(), num_samples);
+    ASSERT_TRUE(gp.PosteriorPredict(basis_test_sqdist, mean, var));
+  }
+
+  Eigen::MatrixXd x_;
+
+  Eigen::VectorXd y_;
+
+  Eigen::VectorXd weight_;
+
+  Eigen::MatrixXd x_test_;
+};
+
+TEST_F(GaussianProcessTest, ExtendedFactorMatchesRefactorization) {
+  const int num_samples = KFixtureSamples + KFixtureAppended;
+  SquaredDistanceCache distance;
+  GaussianProcess extended(1.0, 1.0, 0.1);
+  distance.UpdateTrain(x_.topRows(KFixtureSamples));
+  ASSERT_TRUE(extended.UpdateData(distance, y_.head(KFixtureSamples),
+                                  weight_.head(KFixtureSamples)));
+  distance.UpdateTrain(x_);
+  ASSERT_TRUE(extended.UpdateData(distance, y_, weight_));
+  EXPECT_EQ(extended.GetFactorStatistics().factorizations, 1);
+  EXPECT_EQ(extended.GetFactorStatistics().extensions, 1);
+
+  SquaredDistanceCache full_distance;
+  full_distance.UpdateTrain(x_);
+  GaussianProcess full(1.0, 1.0, 0.1);
+  ASSERT_TRUE(full.UpdateData(full_distance, y_, weight_));
+  EXPECT_EQ(full.GetFactorStatistics().factorizations, 1);
+  EXPECT_EQ(full.GetFactorStatistics().extensions, 0);
+
+  Eigen::VectorXd extended_mean, extended_var, full_mean, full_var;
+  Predict(extended, distance, num_samples, extended_mean, extended_var);
+  Predict(full, full_distance, num_samples, full_mean, full_var);
+  EXPECT_LT((extended_mean - full_mean).cwiseAbs().maxCoeff(),
+            KFixtureTolerance);
+  EXPECT_LT((extended_var - full_var).cwiseAbs().maxCoeff(),
+            KFixtureTolerance);
+}
+
+TEST_F(GaussianProcessTest, NoiseWeightToleranceKeepsFactor) {
+  const double tolerance = 0.03;
+  SquaredDistanceCache distance;
+  GaussianProcess gp(1.0, 1.0, 0.1, tolerance);
+  distance.UpdateTrain(x_.topRows(KFixtureSamples));
+  ASSERT_TRUE(gp.UpdateData(distance, y_.head(KFixtureSamples),
+                            weight_.head(KFixtureSamples)));
+
+  // Weights moved within the tolerance, as by a converged EM run
+  Eigen::VectorXd moved = weight_;
+  moved.head(KFixtureSamples).array() += 0.5 * tolerance;
+  distance.UpdateTrain(x_);
+  ASSERT_TRUE(gp.UpdateData(distance, y_, moved));
+  EXPECT_EQ(gp.GetFactorStatistics().factorizations, 1);
+  EXPECT_EQ(gp.GetFactorStatistics().extensions, 1);
+
+  // Existing rows kept their weights, so it is the factor of those
+  SquaredDistanceCache full_distance;
+  full_distance.UpdateTrain(x_);
+  GaussianProcess full(1.0, 1.0, 0.1);
+  ASSERT_TRUE(full.UpdateData(full_distance, y_, weight_));
+  Eigen::VectorXd mean, var, full_mean, full_var;
+  Predict(gp, distance, x_.rows(), mean, var);
+  Predict(full, full_distance, x_.rows(), full_mean, full_var);
+  EXPECT_LT((mean - full_mean).cwiseAbs().maxCoeff(), KFixtureTolerance);
+  EXPECT_LT((var - full_var).cwiseAbs().maxCoeff(), KFixtureTolerance);
+
+  // Moves beyond the tolerance refactorize
+  moved.array() += 2.0 * tolerance;
+  ASSERT_TRUE(gp.UpdateData(distance, y_, moved));
+  EXPECT_EQ(gp.GetFactorStatistics().factorizations, 2);
+}
+
+TEST_F(GaussianProcessTest, ChangedNoiseRefactorizesWithoutTolerance) {
+  SquaredDistanceCache distance;
+  GaussianProcess gp(1.0, 1.0, 0.1);
+  distance.UpdateTrain(x_.topRows(KFixtureSamples));
+  ASSERT_TRUE(gp.UpdateData(distance, y_.head(KFixtureSamples),
+                            weight_.head(KFixtureSamples)));
+  Eigen::VectorXd moved = weight_;
+  moved(0) += 1e-3;
+  distance.UpdateTrain(x_);
+  ASSERT_TRUE(gp.UpdateData(distance, y_, moved));
+  EXPECT_EQ(gp.GetFactorStatistics().factorizations, 2);
+  EXPECT_EQ(gp.GetFactorStatistics().extensions, 0);
+}
+
+}  // namespace modeling
+}  // namespace sampling
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
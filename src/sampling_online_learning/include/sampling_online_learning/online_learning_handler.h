@@ -8,46 +8,221 @@
 #include <ros/ros.h>
 
 #include <Eigen/Dense>
-#include <boost/functional/hash.hpp>
+#include <chrono>
+#include <functional>
+#include <mutex>
 #include <string>
-#include <unordered_map>
-#include <utility>  // std::pair, std::make_pair
 #include <vector>
 
+#include "sampling_utils/grid_index.h"
+
 namespace sampling {
 namespace learning {
 
 const double KLearningBeta = 0.5;
+// Length scale of the penalty against batch targets close to each other
+const double KGoalSeparationRadius = 1.0;
+// Kernel length scale and noise variance of the fantasized observations
+const double KFantasyLengthScale = 1.0;
+const double KFantasyNoiseVariance = 0.01;
+// Fantasized observations only update test locations within this many
+// length scales, where the squared correlation is down to about 1e-4
+const double KFantasyCutoffLengthScales = 3.0;
+// Candidates scored per block, the block buffers live on the stack
+const int KScoringBlockSize = 256;
 
 const std::string KLearningType_Greedy = "GREEDY";
 const std::string KLearningType_UCB = "UCB";
+const std::string KLearningType_Planning = "PLANNING";
 const std::string KLearningType_Default = KLearningType_Greedy;
 
+// Sampling points planned ahead by PLANNING
+const int KPlanningHorizon = 3;
+// Test locations the PLANNING search chooses from
+const int KPlanningCandidates = 32;
+// Variance given up per unit of travel cost
+const double KPlanningTravelWeight = 0.1;
+// The search returns its best plan so far after this long
+const double KPlanningTimeLimit_s = 0.05;
+
+struct PathPlanningParams {
+  int horizon = KPlanningHorizon;
+
+  int num_candidates = KPlanningCandidates;
+
+  double travel_weight = KPlanningTravelWeight;
+
+  double time_limit_s = KPlanningTimeLimit_s;
+};
+
+/// Costs of moving from a position to each of a list of test locations,
+/// infinity for locations that cannot be reached, false on failure
+typedef std::function<bool(const geometry_msgs::Point &,
+                           const std::vector<int> &, std::vector<double> &)>
+    TravelCostFunction;
+
 class OnlineLearningHandler {
  public:
   OnlineLearningHandler() = delete;
 
   static std::unique_ptr<OnlineLearningHandler> MakeUniqueFromRosParam(
-      ros::NodeHandle &ph);
+      ros::NodeHandle &ph, const Eigen::MatrixXd &test_locations);
 
+  static std::unique_ptr<OnlineLearningHandler> MakeUnique(
+      const std::string &learning_type, const double &learning_beta,
+      const double &goal_separation_radius,
+      const PathPlanningParams &planning_params,
+      const bool &fantasized_variance, const double &fantasy_length_scale,
+      const double &fantasy_noise_variance,
+      const Eigen::MatrixXd &test_locations);
+
+  /// Counts a sample at the test location closest to position. Thread safe,
+  /// may run concurrently with InformativeSelection.
   bool UpdateSampleCount(const geometry_msgs::Point &position);
 
-  bool InformativeSelection(const Eigen::MatrixXd &locations,
+  /// Picks the most informative of the test locations location_ids. mean
+  /// and variance cover all test locations and are read in place, no heap
+  /// memory is allocated.
+  bool InformativeSelection(const std::vector<int> &location_ids,
                             const std::vector<double> &mean,
                             const std::vector<double> &variance,
                             geometry_msgs::Point &informative_point);
 
+  /// PLANNING: plans a sequence of up to planning_horizon test locations
+  /// from start that maximizes the variance collected (penalized near
+  /// earlier points of the sequence as in the batch selection) minus
+  /// travel_weight * travel cost, and returns its first point. The search
+  /// is a depth first branch and bound over the most promising candidates
+  /// that returns the best plan found within the time limit. The limit also
+  /// bounds the travel_cost calls: candidates are dropped once it passes, so
+  /// the call overruns it by at most one travel_cost call. Other types fall
+  /// back to InformativeSelection.
+  bool PathInformativeSelection(const std::vector<int> &location_ids,
+                                const std::vector<double> &mean,
+                                const std::vector<double> &variance,
+                                const geometry_msgs::Point &start,
+                                const TravelCostFunction &travel_cost,
+                                geometry_msgs::Point &informative_point);
+
+  bool IsPathPlanning() const;
+
+  /// Lowers variance as if a noisy sample had been taken at every position,
+  /// one rank one update each. The covariance between two locations is
+  /// approximated by rho * sqrt(var_a * var_b) with an RBF correlation rho,
+  /// so no model is refitted and only test locations near a position are
+  /// touched.
+  bool FantasizeVariance(const std::vector<geometry_msgs::Point> &positions,
+                         std::vector<double> &variance) const;
+
+  /// Whether goals should be selected from fantasized variance
+  bool UsesFantasizedVariance() const;
+
+  /// Picks one point per agent in order, from the test locations
+  /// *location_ids[i] into points[i]. The exploration part of the score is
+  /// scaled by 1 - exp(-d^2 / (2 r^2)) for every point picked before, so
+  /// that agents are not sent next to each other. Every agent, i.e. every
+  /// location_ids pointer, may appear only once.
+  bool BatchInformativeSelection(
+      const std::vector<const std::vector<int> *> &location_ids,
+      const std::vector<double> &mean, const std::vector<double> &variance,
+      std::vector<geometry_msgs::Point> &points);
+
  private:
   OnlineLearningHandler(const std::string &learning_type,
-                        const double &learning_beta);
+                        const double &learning_beta,
+                        const double &goal_separation_radius,
+                        const PathPlanningParams &planning_params,
+                        const bool &fantasized_variance,
+                        const double &fantasy_length_scale,
+                        const double &fantasy_noise_variance,
+                        const Eigen::MatrixXd &test_locations);
+
+  /// State of one branch and bound search over the candidates of
+  /// PathInformativeSelection
+  struct PathSearch {
+    int num_candidates;
+
+    int horizon;
+
+    std::vector<double> variance;
+
+    // Travel cost from start, and between candidates row to column
+    std::vector<double> start_cost;
+
+    Eigen::MatrixXd travel_cost;
+
+    // Separation penalty factor between two candidates
+    Eigen::MatrixXd penalty;
 
-  std::unordered_map<std::pair<double, double>, double,
-                     boost::hash<std::pair<double, double>>>
-      count_map_;
+    // Sum of the k largest candidate variances
+    std::vector<double> top_variance;
+
+    std::vector<bool> is_used;
+
+    std::vector<int> path;
+
+    // Candidate order of every depth, reused between nodes
+    std::vector<std::vector<std::pair<double, int>>> children;
+
+    std::vector<int> best_path;
+
+    double best_utility;
+
+    std::chrono::steady_clock::time_point deadline;
+
+    bool is_timeout;
+  };
+
+  /// Tries every extension of search.path, which reached utility, best
+  /// first while the bound can still beat search.best_utility.
+  void ExtendPath(PathSearch &search, const double &utility) const;
+
+  /// Index into location_ids of the highest score, penalized near the
+  /// num_picked points of picked.
+  bool SelectLocation(const std::vector<int> &location_ids,
+                      const std::vector<double> &mean,
+                      const std::vector<double> &variance,
+                      const geometry_msgs::Point *picked,
+                      const int &num_picked, int &max_index);
+
+  /// Multiplies the scores of the locations ids by the separation penalty
+  /// of every picked point.
+  void ApplySeparationPenalty(const int *ids,
+                              const geometry_msgs::Point *picked,
+                              const int &num_picked,
+                              Eigen::Ref<Eigen::ArrayXd> score) const;
+
+  /// Index into location_ids of the highest score, scores are evaluated
+  /// block by block into a stack buffer by score(ids, block) and reduced
+  /// with Eigen packet math.
+  template <typename ScoreFunction>
+  static int ArgMaxScore(const std::vector<int> &location_ids,
+                         const ScoreFunction &score);
+
+  Eigen::MatrixXd test_locations_;
+
+  // Snaps sample positions to test locations
+  utils::GridIndex location_index_;
+
+  // Samples counted at every test location
+  std::vector<int> visit_count_;
+
+  // Guards visit_count_ only
+  std::mutex count_mutex_;
 
   std::string learning_type_;
 
   double learning_beta_;
+
+  double goal_separation_radius_;
+
+  PathPlanningParams planning_params_;
+
+  bool fantasized_variance_;
+
+  double fantasy_length_scale_;
+
+  double fantasy_noise_variance_;
 };
 }  // namespace learning
 }  // namespace sampling
\ No newline at end of file
@@ -1,74 +1,492 @@
 #include "sampling_online_learning/online_learning_handler.h"
 
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <utility>
+
 #include "sampling_utils/utils.h"
 
 namespace sampling {
 namespace learning {
 
 std::unique_ptr<OnlineLearningHandler>
-OnlineLearningHandler::MakeUniqueFromRosParam(ros::NodeHandle &ph) {
+OnlineLearningHandler::MakeUniqueFromRosParam(
+    ros::NodeHandle &ph, const Eigen::MatrixXd &test_locations) {
   std::string learning_type;
   double learning_beta;
+  double goal_separation_radius;
   ph.param<std::string>("learning_type", learning_type, KLearningType_Default);
   ph.param<double>("learning_beta", learning_beta, KLearningBeta);
-  return std::unique_ptr<OnlineLearningHandler>(
-      new OnlineLearningHandler(learning_type, learning_beta));
+  ph.param<double>("goal_separation_radius", goal_separation_radius,
+                   KGoalSeparationRadius);
+  PathPlanningParams planning_params;
+  ph.param<int>("planning_horizon", planning_params.horizon,
+                KPlanningHorizon);
+  ph.param<int>("planning_candidates", planning_params.num_candidates,
+                KPlanningCandidates);
+  ph.param<double>("planning_travel_weight", planning_params.travel_weight,
+                   KPlanningTravelWeight);
+  ph.param<double>("planning_time_limit", planning_params.time_limit_s,
+                   KPlanningTimeLimit_s);
+  bool fantasized_variance;
+  double fantasy_length_scale;
+  double fantasy_noise_variance;
+  ph.param<bool>("fantasized_variance", fantasized_variance, false);
+  ph.param<double>("fantasy_length_scale", fantasy_length_scale,
+                   KFantasyLengthScale);
+  ph.param<double>("fantasy_noise_variance", fantasy_noise_variance,
+                   KFantasyNoiseVariance);
+  return MakeUnique(learning_type, learning_beta, goal_separation_radius,
+                    planning_params, fantasized_variance, fantasy_length_scale,
+                    fantasy_noise_variance, test_locations);
+}
+
+std::unique_ptr<OnlineLearningHandler> OnlineLearningHandler::MakeUnique(
+    const std::string &learning_type, const double &learning_beta,
+    const double &goal_separation_radius,
+    const PathPlanningParams &planning_params, const bool &fantasized_variance,
+    const double &fantasy_length_scale, const double &fantasy_noise_variance,
+    const Eigen::MatrixXd &test_locations) {
+  if (fantasy_length_scale <= 0.0 || fantasy_noise_variance <= 0.0) {
+    ROS_ERROR_STREAM("Fantasy length scale and noise must be positive!");
+    return nullptr;
+  }
+  if (planning_params.horizon < 1 || planning_params.num_candidates < 1 ||
+      planning_params.travel_weight < 0.0) {
+    ROS_ERROR_STREAM("Invalid path planning parameters!");
+    return nullptr;
+  }
+  return std::unique_ptr<OnlineLearningHandler>(new OnlineLearningHandler(
+      learning_type, learning_beta, goal_separation_radius, planning_params,
+      fantasized_variance, fantasy_length_scale, fantasy_noise_variance,
+      test_locations));
 }
 
 bool OnlineLearningHandler::UpdateSampleCount(
     const geometry_msgs::Point &position) {
-  count_map_[std::make_pair(position.x, position.y)] += 1.0;
+  const int id = location_index_.NearestSearch(position.x, position.y);
+  if (id < 0) return false;
+  std::lock_guard<std::mutex> lock(count_mutex_);
+  ++visit_count_[id];
   return true;
 }
 
 bool OnlineLearningHandler::InformativeSelection(
-    const Eigen::MatrixXd &locations, const std::vector<double> &mean,
+    const std::vector<int> &location_ids, const std::vector<double> &mean,
     const std::vector<double> &variance,
     geometry_msgs::Point &informative_point) {
-  const size_t location_size = locations.rows();
-  if (location_size != mean.size() || location_size != variance.size()) {
+  if (location_ids.empty() || mean.size() != test_locations_.rows() ||
+      variance.size() != test_locations_.rows()) {
     ROS_ERROR_STREAM("Informative point selection data does NOT match!");
     return false;
   }
 
-  if (KLearningType_Greedy.compare(learning_type_) == 0) {
-    double max_variance = 0.0;
-    int max_variance_index = 0;
-    for (int i = 0; i < variance.size(); ++i) {
-      if (variance[i] > max_variance) {
-        max_variance = variance[i];
-        max_variance_index = i;
+  int max_index;
+  if (!SelectLocation(location_ids, mean, variance, nullptr, 0, max_index)) {
+    return false;
+  }
+
+  informative_point.x = test_locations_(location_ids[max_index], 0);
+  informative_point.y = test_locations_(location_ids[max_index], 1);
+  return true;
+}
+
+bool OnlineLearningHandler::PathInformativeSelection(
+    const std::vector<int> &location_ids, const std::vector<double> &mean,
+    const std::vector<double> &variance, const geometry_msgs::Point &start,
+    const TravelCostFunction &travel_cost,
+    geometry_msgs::Point &informative_point) {
+  if (!IsPathPlanning()) {
+    return InformativeSelection(location_ids, mean, variance,
+                                informative_point);
+  }
+  // The time limit covers the candidate selection too
+  const std::chrono::steady_clock::time_point deadline =
+      std::chrono::steady_clock::now() +
+      std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+          std::chrono::duration<double>(planning_params_.time_limit_s));
+  if (location_ids.empty() || mean.size() != test_locations_.rows() ||
+      variance.size() != test_locations_.rows()) {
+    ROS_ERROR_STREAM("Informative point selection data does NOT match!");
+    return false;
+  }
+
+  // Candidates are the locations of highest variance and of highest
+  // variance net of the travel cost from start, half of them each
+  const double travel_weight = planning_params_.travel_weight;
+  std::vector<std::pair<double, int>> by_variance(location_ids.size());
+  std::vector<std::pair<double, int>> by_utility(location_ids.size());
+  std::vector<double> start_cost;
+  if (!travel_cost(start, location_ids, start_cost) ||
+      start_cost.size() != location_ids.size()) {
+    ROS_ERROR_STREAM("Failed to get travel cost for path planning!");
+    return false;
+  }
+  for (int k = 0; k < location_ids.size(); ++k) {
+    start_cost[k] = std::max(start_cost[k], 0.0);
+    const double location_variance = variance[location_ids[k]];
+    by_variance[k] = std::make_pair(-location_variance, k);
+    by_utility[k] =
+        std::make_pair(travel_weight * start_cost[k] - location_variance, k);
+  }
+  int num_candidates = std::min<int>(planning_params_.num_candidates,
+                                     location_ids.size());
+  const int num_by_utility = (num_candidates + 1) / 2;
+  std::partial_sort(by_utility.begin(), by_utility.begin() + num_by_utility,
+                    by_utility.end());
+  // Enough to fill up the candidates whatever the overlap
+  std::partial_sort(by_variance.begin(), by_variance.begin() + num_candidates,
+                    by_variance.end());
+  std::vector<int> candidates;
+  std::vector<bool> is_candidate(location_ids.size(), false);
+  for (int k = 0; k < num_by_utility; ++k) {
+    candidates.push_back(by_utility[k].second);
+    is_candidate[by_utility[k].second] = true;
+  }
+  for (int k = 0; candidates.size() < num_candidates; ++k) {
+    if (is_candidate[by_variance[k].second]) continue;
+    candidates.push_back(by_variance[k].second);
+    is_candidate[by_variance[k].second] = true;
+  }
+
+  PathSearch search;
+  search.variance.resize(num_candidates);
+  search.start_cost.resize(num_candidates);
+  search.travel_cost.resize(num_candidates, num_candidates);
+  search.penalty.setOnes(num_candidates, num_candidates);
+  const double scale =
+      goal_separation_radius_ > 0.0
+          ? -0.5 / (goal_separation_radius_ * goal_separation_radius_)
+          : 0.0;
+  std::vector<int> candidate_ids(num_candidates);
+  for (int a = 0; a < num_candidates; ++a) {
+    candidate_ids[a] = location_ids[candidates[a]];
+    search.variance[a] = variance[candidate_ids[a]];
+    search.start_cost[a] = start_cost[candidates[a]];
+  }
+  // Every leg is one travel_cost call, a full shortest path search with
+  // geodesic distances. Candidates whose legs are not built by the deadline
+  // are dropped. The best one step candidate comes first and needs no leg to
+  // be planned alone, so it is kept whatever the time.
+  std::vector<double> leg_cost;
+  int num_legs = 0;
+  for (int a = 0; a < num_candidates; ++a, ++num_legs) {
+    if (std::chrono::steady_clock::now() > deadline) break;
+    const int id = candidate_ids[a];
+    geometry_msgs::Point position;
+    position.x = test_locations_(id, 0);
+    position.y = test_locations_(id, 1);
+    if (!travel_cost(position, candidate_ids, leg_cost) ||
+        leg_cost.size() != num_candidates) {
+      ROS_ERROR_STREAM("Failed to get travel cost for path planning!");
+      return false;
+    }
+    for (int b = 0; b < num_candidates; ++b) {
+      const int other_id = candidate_ids[b];
+      search.travel_cost(a, b) = std::max(leg_cost[b], 0.0);
+      if (scale < 0.0) {
+        const double sqdist =
+            (test_locations_.row(id) - test_locations_.row(other_id))
+                .squaredNorm();
+        search.penalty(a, b) = 1.0 - std::exp(sqdist * scale);
       }
     }
+  }
+  if (num_legs < num_candidates) {
+    ROS_DEBUG_STREAM("Path planning hit the time limit after "
+                     << num_legs << " of " << num_candidates << " candidates");
+    num_candidates = std::max(num_legs, 1);
+    search.travel_cost(0, 0) = 0.0;
+    search.variance.resize(num_candidates);
+    search.start_cost.resize(num_candidates);
+    search.travel_cost.conservativeResize(num_candidates, num_candidates);
+    search.penalty.conservativeResize(num_candidates, num_candidates);
+  }
+  search.num_candidates = num_candidates;
+  search.horizon = std::min(planning_params_.horizon, num_candidates);
+  std::vector<double> sorted_variance = search.variance;
+  std::sort(sorted_variance.begin(), sorted_variance.end(),
+            std::greater<double>());
+  search.top_variance.assign(1, 0.0);
+  for (const double &v : sorted_variance) {
+    search.top_variance.push_back(search.top_variance.back() + v);
+  }
+  search.is_used.assign(num_candidates, false);
+  search.children.resize(search.horizon);
+  search.best_utility = -std::numeric_limits<double>::infinity();
+  search.deadline = deadline;
+  search.is_timeout = false;
+  ExtendPath(search, 0.0);
+  if (search.best_path.empty()) {
+    ROS_ERROR_STREAM("Path planning found no sampling point!");
+    return false;
+  }
+  if (search.is_timeout) {
+    ROS_DEBUG_STREAM("Path planning hit the time limit, using best plan");
+  }
 
-    informative_point.x = locations(max_variance_index, 0);
-    informative_point.y = locations(max_variance_index, 1);
+  const int id = location_ids[candidates[search.best_path.front()]];
+  informative_point.x = test_locations_(id, 0);
+  informative_point.y = test_locations_(id, 1);
+  return true;
+}
 
-    return true;
-  } else if (KLearningType_UCB.compare(learning_type_) == 0) {
-    Eigen::VectorXd utility = Eigen::VectorXd(location_size);
-    for (int i = 0; i < location_size; ++i) {
-      utility(i) =
-          mean[i] +
-          variance[i] * learning_beta_ /
-              (count_map_[std::make_pair(locations(i, 0), locations(i, 1))] +
-               1.0);
+bool OnlineLearningHandler::IsPathPlanning() const {
+  return KLearningType_Planning.compare(learning_type_) == 0;
+}
+
+void OnlineLearningHandler::ExtendPath(PathSearch &search,
+                                       const double &utility) const {
+  const int depth = search.path.size();
+  if (depth > 0 && utility > search.best_utility) {
+    search.best_utility = utility;
+    search.best_path = search.path;
+  }
+  if (depth == search.horizon) return;
+
+  std::vector<std::pair<double, int>> &children = search.children[depth];
+  children.clear();
+  const double travel_weight = planning_params_.travel_weight;
+  for (int j = 0; j < search.num_candidates; ++j) {
+    if (search.is_used[j]) continue;
+    const double travel_cost =
+        depth == 0 ? search.start_cost[j]
+                   : search.travel_cost(search.path.back(), j);
+    // Unreachable
+    if (std::isinf(travel_cost)) continue;
+    double gain = search.variance[j];
+    for (const int &p : search.path) gain *= search.penalty(p, j);
+    gain -= travel_weight * travel_cost;
+    children.push_back(std::make_pair(-gain, j));
+  }
+  std::sort(children.begin(), children.end());
+
+  for (const std::pair<double, int> &child : children) {
+    // Penalties and travel costs only lower the variance still to collect
+    const double bound =
+        utility + search.top_variance[search.horizon - depth];
+    if (bound <= search.best_utility || search.is_timeout) return;
+    // The time limit is only checked between siblings, so the first, greedy
+    // descent always completes
+    if (&child != &children.front() &&
+        std::chrono::steady_clock::now() > search.deadline) {
+      search.is_timeout = true;
+      return;
+    }
+    search.is_used[child.second] = true;
+    search.path.push_back(child.second);
+    ExtendPath(search, utility - child.first);
+    search.path.pop_back();
+    search.is_used[child.second] = false;
+  }
+}
+
+bool OnlineLearningHandler::FantasizeVariance(
+    const std::vector<geometry_msgs::Point> &positions,
+    std::vector<double> &variance) const {
+  if (variance.size() != test_locations_.rows()) {
+    ROS_ERROR_STREAM("Fantasized variance data does NOT match!");
+    return false;
+  }
+  if (positions.empty()) return true;
+
+  // Variance at every position, taken from the closest test location
+  const int num_positions = positions.size();
+  Eigen::MatrixXd position_matrix(num_positions, 2);
+  Eigen::VectorXd position_std(num_positions);
+  for (int a = 0; a < num_positions; ++a) {
+    const int id = location_index_.NearestSearch(positions[a].x,
+                                                 positions[a].y);
+    if (id < 0) return false;
+    position_matrix(a, 0) = positions[a].x;
+    position_matrix(a, 1) = positions[a].y;
+    position_std(a) = std::sqrt(std::max(variance[id], 0.0));
+  }
+
+  // Cholesky factor of the fantasized observations' covariance, solving
+  // with it applies one rank one update per position in order
+  const double inverse_sq_length =
+      1.0 / (fantasy_length_scale_ * fantasy_length_scale_);
+  Eigen::MatrixXd covariance(num_positions, num_positions);
+  for (int a = 0; a < num_positions; ++a) {
+    for (int b = 0; b < num_positions; ++b) {
+      const double sqdist =
+          (position_matrix.row(a) - position_matrix.row(b)).squaredNorm();
+      covariance(a, b) = std::exp(-0.5 * sqdist * inverse_sq_length) *
+                         position_std(a) * position_std(b);
+    }
+    covariance(a, a) += fantasy_noise_variance_;
+  }
+  const Eigen::LLT<Eigen::MatrixXd> factor(covariance);
+  if (factor.info() != Eigen::Success) {
+    ROS_ERROR_STREAM("Failed to factorize fantasized covariance!");
+    return false;
+  }
+
+  // Only test locations near a position are updated, each once
+  thread_local std::vector<int> nearby;
+  thread_local std::vector<int> updated;
+  updated.clear();
+  const double radius = KFantasyCutoffLengthScales * fantasy_length_scale_;
+  for (const geometry_msgs::Point &position : positions) {
+    location_index_.RadiusSearch(position.x, position.y, radius, nearby);
+    updated.insert(updated.end(), nearby.begin(), nearby.end());
+  }
+  std::sort(updated.begin(), updated.end());
+  updated.erase(std::unique(updated.begin(), updated.end()), updated.end());
+
+  Eigen::VectorXd cross_covariance(num_positions);
+  for (const int &i : updated) {
+    const double location_std = std::sqrt(std::max(variance[i], 0.0));
+    for (int a = 0; a < num_positions; ++a) {
+      const double sqdist =
+          (test_locations_.row(i) - position_matrix.row(a)).squaredNorm();
+      cross_covariance(a) = std::exp(-0.5 * sqdist * inverse_sq_length) *
+                            location_std * position_std(a);
+    }
+    factor.matrixL().solveInPlace(cross_covariance);
+    variance[i] = std::max(variance[i] - cross_covariance.squaredNorm(), 0.0);
+  }
+  return true;
+}
+
+bool OnlineLearningHandler::UsesFantasizedVariance() const {
+  return fantasized_variance_;
+}
+
+bool OnlineLearningHandler::BatchInformativeSelection(
+    const std::vector<const std::vector<int> *> &location_ids,
+    const std::vector<double> &mean, const std::vector<double> &variance,
+    std::vector<geometry_msgs::Point> &points) {
+  if (mean.size() != test_locations_.rows() ||
+      variance.size() != test_locations_.rows()) {
+    ROS_ERROR_STREAM("Informative point selection data does NOT match!");
+    return false;
+  }
+  for (int i = 0; i < location_ids.size(); ++i) {
+    if (location_ids[i] == nullptr || location_ids[i]->empty()) {
+      ROS_ERROR_STREAM("Informative point selection data does NOT match!");
+      return false;
     }
-    int max_utility_index = utility.maxCoeff();
-    informative_point.x = locations(max_utility_index, 0);
-    informative_point.y = locations(max_utility_index, 1);
-    return true;
+    // The same cells twice would be one agent penalized by its own pick
+    for (int j = 0; j < i; ++j) {
+      if (location_ids[j] == location_ids[i]) {
+        ROS_ERROR_STREAM("Repeated agent in batch informative selection!");
+        return false;
+      }
+    }
+  }
+
+  points.resize(location_ids.size());
+  for (int i = 0; i < location_ids.size(); ++i) {
+    int max_index;
+    if (!SelectLocation(*location_ids[i], mean, variance, points.data(), i,
+                        max_index)) {
+      return false;
+    }
+    points[i].x = test_locations_((*location_ids[i])[max_index], 0);
+    points[i].y = test_locations_((*location_ids[i])[max_index], 1);
+    points[i].z = 0.0;
+  }
+  return true;
+}
+
+bool OnlineLearningHandler::SelectLocation(
+    const std::vector<int> &location_ids, const std::vector<double> &mean,
+    const std::vector<double> &variance, const geometry_msgs::Point *picked,
+    const int &num_picked, int &max_index) {
+  // PLANNING picks single points like GREEDY
+  if (KLearningType_Greedy.compare(learning_type_) == 0 || IsPathPlanning()) {
+    max_index = ArgMaxScore(
+        location_ids, [&](const int *ids, Eigen::Ref<Eigen::ArrayXd> score) {
+          for (int k = 0; k < score.size(); ++k) score(k) = variance[ids[k]];
+          ApplySeparationPenalty(ids, picked, num_picked, score);
+        });
+  } else if (KLearningType_UCB.compare(learning_type_) == 0) {
+    std::lock_guard<std::mutex> lock(count_mutex_);
+    max_index = ArgMaxScore(
+        location_ids, [&](const int *ids, Eigen::Ref<Eigen::ArrayXd> score) {
+          // Gathered into the score buffer first, the arithmetic is then
+          // vectorized over the whole block
+          Eigen::Array<double, Eigen::Dynamic, 1, 0, KScoringBlockSize, 1>
+              count(score.size());
+          for (int k = 0; k < score.size(); ++k) {
+            score(k) = variance[ids[k]];
+            count(k) = visit_count_[ids[k]];
+          }
+          score = score * learning_beta_ / (count + 1.0);
+          ApplySeparationPenalty(ids, picked, num_picked, score);
+          for (int k = 0; k < score.size(); ++k) score(k) += mean[ids[k]];
+        });
   } else {
     ROS_ERROR_STREAM("Unknown informative point selection method!");
     return false;
   }
+  return true;
+}
+
+void OnlineLearningHandler::ApplySeparationPenalty(
+    const int *ids, const geometry_msgs::Point *picked, const int &num_picked,
+    Eigen::Ref<Eigen::ArrayXd> score) const {
+  if (num_picked == 0 || goal_separation_radius_ <= 0.0) return;
+  typedef Eigen::Array<double, Eigen::Dynamic, 1, 0, KScoringBlockSize, 1>
+      BlockArray;
+  BlockArray x(score.size());
+  BlockArray y(score.size());
+  for (int k = 0; k < score.size(); ++k) {
+    x(k) = test_locations_(ids[k], 0);
+    y(k) = test_locations_(ids[k], 1);
+  }
+  const double scale =
+      -0.5 / (goal_separation_radius_ * goal_separation_radius_);
+  for (int p = 0; p < num_picked; ++p) {
+    const BlockArray sqdist =
+        (x - picked[p].x).square() + (y - picked[p].y).square();
+    score *= 1.0 - (sqdist * scale).exp();
+  }
+}
 
-  return false;
+template <typename ScoreFunction>
+int OnlineLearningHandler::ArgMaxScore(const std::vector<int> &location_ids,
+                                       const ScoreFunction &score) {
+  Eigen::Array<double, KScoringBlockSize, 1> block;
+  int max_index = 0;
+  double max_score = -std::numeric_limits<double>::infinity();
+  for (int start = 0; start < location_ids.size();
+       start += KScoringBlockSize) {
+    const int size =
+        std::min<int>(KScoringBlockSize, location_ids.size() - start);
+    score(location_ids.data() + start, block.head(size));
+    int block_index;
+    const double block_max = block.head(size).maxCoeff(&block_index);
+    // Strict comparison keeps the first of equal scores
+    if (block_max > max_score) {
+      max_score = block_max;
+      max_index = start + block_index;
+    }
+  }
+  return max_index;
 }
 
-OnlineLearningHandler::OnlineLearningHandler(const std::string &learning_type,
-                                             const double &learning_beta)
-    : learning_type_(learning_type), learning_beta_(learning_beta) {}
+OnlineLearningHandler::OnlineLearningHandler(
+    const std::string &learning_type, const double &learning_beta,
+    const double &goal_separation_radius,
+    const PathPlanningParams &planning_params,
+    const bool &fantasized_variance, const double &fantasy_length_scale,
+    const double &fantasy_noise_variance,
+    const Eigen::MatrixXd &test_locations)
+    : test_locations_(test_locations),
+      location_index_(test_locations),
+      visit_count_(test_locations.rows(), 0),
+      learning_type_(learning_type),
+      learning_beta_(learning_beta),
+      goal_separation_radius_(goal_separation_radius),
+      planning_params_(planning_params),
+      fantasized_variance_(fantasized_variance),
+      fantasy_length_scale_(fantasy_length_scale),
+      fantasy_noise_variance_(fantasy_noise_variance) {}
 
 }  // namespace learning
 }  // namespace sampling
\ No newline at end of file
@@ -0,0 +1,134 @@
+#include <gtest/gtest.h>
+
+#include <Eigen/Dense>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "sampling_online_learning/online_learning_handler.h"
+
+namespace sampling {
+namespace learning {
+
+const int KFixtureGridSize = 20;
+// Stands in for a geodesic travel cost, a full shortest path search per call
+const double KSlowTravelCost_s = 0.02;
+
+Eigen::MatrixXd MakeGrid() {
+  const int num_locations = KFixtureGridSize * KFixtureGridSize;
+  Eigen::MatrixXd locations(num_locations, 2);
+  for (int i = 0; i < num_locations; ++i) {
+    locations(i, 0) = i / KFixtureGridSize;
+    locations(i, 1) = i % KFixtureGridSize;
+  }
+  return locations;
+}
+
+/// Straight line costs that take delay_s per call
+TravelCostFunction MakeTravelCost(const Eigen::MatrixXd &locations,
+                                  const double &delay_s) {
+  return [locations, delay_s](const geometry_msgs::Point &position,
+                              const std::vector<int> &ids,
+                              std::vector<double> &cost) {
+    std::this_thread::sleep_for(std::chrono::duration<double>(delay_s));
+    cost.resize(ids.size());
+    for (int k = 0; k < ids.size(); ++k) {
+      cost[k] = std::hypot(locations(ids[k], 0) - position.x,
+                           locations(ids[k], 1) - position.y);
+    }
+    return true;
+  };
+}
+
+/// Variance peaks at different places, so that travel matters
+std::vector<double> MakeVariance(const Eigen::MatrixXd &locations) {
+  std::vector<double> variance(locations.rows());
+  for (int i = 0; i < locations.rows(); ++i) {
+    variance[i] = 1.0 + std::sin(0.7 * locations(i, 0)) *
+                            std::cos(0.4 * locations(i, 1));
+  }
+  return variance;
+}
+
+TEST(OnlineLearningHandlerTest, PathPlanningWithinTimeLimit) {
+  const Eigen::MatrixXd locations = MakeGrid();
+  PathPlanningParams planning_params;
+  std::unique_ptr<OnlineLearningHandler> handler =
+      OnlineLearningHandler::MakeUnique(
+          KLearningType_Planning, KLearningBeta, KGoalSeparationRadius,
+          planning_params, false, KFantasyLengthScale, KFantasyNoiseVariance,
+          locations);
+  ASSERT_NE(handler, nullptr);
+
+  std::vector<int> location_ids(locations.rows());
+  for (int i = 0; i < location_ids.size(); ++i) location_ids[i] = i;
+  const std::vector<double> mean(locations.rows(), 0.0);
+  const std::vector<double> variance = MakeVariance(locations);
+  geometry_msgs::Point start;
+  geometry_msgs::Point point;
+
+  // Building every leg would take num_candidates + 1 slow calls
+  const std::chrono::steady_clock::time_point begin =
+      std::chrono::steady_clock::now();
+  ASSERT_TRUE(handler->PathInformativeSelection(
+      location_ids, mean, variance, start,
+      MakeTravelCost(locations, KSlowTravelCost_s), point));
+  const double elapsed_s = std::chrono::duration<double>(
+                               std::chrono::steady_clock::now() - begin)
+                               .count();
+  // One call may start right before the deadline, plus scheduling slack
+  EXPECT_LT(elapsed_s, planning_params.time_limit_s + 2 * KSlowTravelCost_s);
+  EXPECT_GE(point.x, 0.0);
+  EXPECT_GE(point.y, 0.0);
+}
+
+TEST(OnlineLearningHandlerTest, PathPlanningPastDeadlineKeepsBestCandidate) {
+  const Eigen::MatrixXd locations = MakeGrid();
+  PathPlanningParams planning_params;
+  planning_params.time_limit_s = 0.0;
+  std::unique_ptr<OnlineLearningHandler> handler =
+      OnlineLearningHandler::MakeUnique(
+          KLearningType_Planning, KLearningBeta, KGoalSeparationRadius,
+          planning_params, false, KFantasyLengthScale, KFantasyNoiseVariance,
+          locations);
+  ASSERT_NE(handler, nullptr);
+
+  std::vector<int> location_ids(locations.rows());
+  for (int i = 0; i < location_ids.size(); ++i) location_ids[i] = i;
+  const std::vector<double> mean(locations.rows(), 0.0);
+  const std::vector<double> variance = MakeVariance(locations);
+  geometry_msgs::Point start;
+  start.x = 5.0;
+  start.y = 5.0;
+  geometry_msgs::Point point;
+  ASSERT_TRUE(handler->PathInformativeSelection(
+      location_ids, mean, variance, start, MakeTravelCost(locations, 0.0),
+      point));
+
+  // Only the start costs are known, the best single step wins
+  double best_utility = -std::numeric_limits<double>::infinity();
+  int best_id = -1;
+  for (int i = 0; i < locations.rows(); ++i) {
+    const double utility =
+        variance[i] - planning_params.travel_weight *
+                          std::hypot(locations(i, 0) - start.x,
+                                     locations(i, 1) - start.y);
+    if (utility > best_utility) {
+      best_utility = utility;
+      best_id = i;
+    }
+  }
+  EXPECT_EQ(point.x, locations(best_id, 0));
+  EXPECT_EQ(point.y, locations(best_id, 1));
+}
+
+}  // namespace learning
+}  // namespace sampling
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
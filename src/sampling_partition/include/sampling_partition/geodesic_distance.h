@@ -0,0 +1,74 @@
+/**
+ * Obstacle aware distances over the graph of map cells
+ */
+
+#pragma once
+
+#include <geometry_msgs/Point.h>
+
+#include <Eigen/Dense>
+#include <limits>
+#include <vector>
+
+#include "sampling_utils/grid_index.h"
+
+namespace sampling {
+namespace partition {
+
+// Cells are linked to neighbors within this many cell spacings. sqrt(5)
+// includes the (1, 2) moves of a grid, which keeps shortest paths within
+// about 3% of the straight line in open space.
+const double KGeodesicConnectionSpacing = 2.25;
+// An edge is blocked by any impassable cell this many cell spacings from
+// its midpoint, so paths neither cut wall corners nor pass between the cells
+// of a diagonal wall
+const double KGeodesicGuardSpacing = 0.75;
+
+class GeodesicDistanceGraph {
+ public:
+  GeodesicDistanceGraph() = delete;
+
+  /// Links the map cells to their neighbors, the cell spacing is the median
+  /// distance to the closest other cell.
+  explicit GeodesicDistanceGraph(const Eigen::MatrixXd &map);
+
+  /// Map cell the distances from a position are computed from
+  int GetSourceCell(const geometry_msgs::Point &position) const;
+
+  /// Shortest path length from source_cell to every cell, moving through
+  /// passable cells only (the source itself always is). Unreachable cells
+  /// get infinity. Every call is a full Dijkstra search, there
+  /// is no incremental update of an earlier field.
+  void ComputeDistance(const int &source_cell,
+                       const std::vector<bool> &passable,
+                       Eigen::ArrayXd &distance) const;
+
+  /// Same as ComputeDistance, but stops as soon as all target cells are
+  /// settled. Only the target distances are final then.
+  void ComputeDistance(const int &source_cell,
+                       const std::vector<bool> &passable,
+                       const std::vector<int> &targets,
+                       Eigen::ArrayXd &distance) const;
+
+  double GetSpacing() const;
+
+ private:
+  utils::GridIndex index_;
+
+  double spacing_;
+
+  // Directed edges of cell i are [edge_start_[i], edge_start_[i + 1])
+  std::vector<int> edge_start_;
+
+  std::vector<int> edge_target_;
+
+  std::vector<double> edge_length_;
+
+  // Cells near the midpoint of edge e are
+  // guard_cells_[guard_start_[e], guard_start_[e + 1])
+  std::vector<int> guard_start_;
+
+  std::vector<int> guard_cells_;
+};
+}  // namespace partition
+}  // namespace sampling
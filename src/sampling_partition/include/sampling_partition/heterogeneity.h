@@ -3,8 +3,11 @@
 #include <geometry_msgs/Point.h>
 
 #include <Eigen/Dense>
+#include <memory>
+#include <string>
 
 #include "sampling_partition/heterogeneity_params.h"
+#include "sampling_utils/grid_index.h"
 
 namespace sampling {
 namespace partition {
@@ -16,22 +19,59 @@ const std::string KHeterogeneitySpeed = "SPEED";
 const std::string KHeterogeneityBatteryLife = "BATTERY_LIFE";
 const std::string KHeterogeneityTraversability = "TRAVERSABILITY";
 
+// Map cells per block of the fused cost kernel, small enough for the
+// distance and cost blocks to stay in L1
+const int KCostKernelBlockSize = 256;
+
+/// Type of a configured heterogeneity name, false if it is unknown
+bool ParseHeterogeneityType(const std::string &name, HeterogeneityType &type);
+
+/// Whether the cost of type does not depend on the agent position, those
+/// have a static cost instead of a tanh cost term
+bool IsStaticHeterogeneity(const HeterogeneityType &type);
+
+/// Position dependent cost weight * (tanh(scale * distance) + offset), the
+/// form of every heterogeneity that is not static. Plain data, so cost
+/// kernels evaluate it without virtual calls.
+struct TanhCostTerm {
+  double scale;
+
+  double offset;
+
+  double weight;
+
+  bool fast_math;
+};
+
+/// Adds the cost of term to cost, with utils::FastTanh if term.fast_math.
+void AccumulateTanhCost(const TanhCostTerm &term,
+                        const Eigen::Ref<const Eigen::ArrayXd> &distance,
+                        Eigen::Ref<Eigen::ArrayXd> cost);
+
 class Heterogeneity {
  public:
   Heterogeneity() = delete;
 
-  virtual Eigen::VectorXd CalculateCost(
-      const geometry_msgs::Point &agent_position,
-      const Eigen::VectorXd &distance) = 0;
+  /// Heterogeneity of params.type. map_index indexes the map cells and is
+  /// shared by all heterogeneities built for the same map.
+  static std::unique_ptr<Heterogeneity> MakeUnique(
+      const HeterogeneityParams &params, const utils::GridIndex &map_index);
 
-  std::string GetType();
+  virtual ~Heterogeneity() = default;
+
+  /// Cost of every map cell when it does not depend on the agent position,
+  /// nullptr otherwise. The partition sums static costs once at startup
+  /// instead of adding them to every cost column.
+  virtual const Eigen::ArrayXd *GetStaticCost() const;
+
+  /// Fills term with the cost weighted by weight if it is a tanh of the
+  /// distance, returns false otherwise.
+  virtual bool GetTanhCostTerm(const double &weight, TanhCostTerm &term) const;
 
  protected:
-  Heterogeneity(const HeterogeneityParams &params, const Eigen::MatrixXd &map);
+  explicit Heterogeneity(const HeterogeneityParams &params);
 
   HeterogeneityParams params_;
-
-  Eigen::MatrixXd map_;
 };
 }  // namespace partition
 }  // namespace sampling
\ No newline at end of file
@@ -12,11 +12,10 @@ class HeterogeneityDistance : public Heterogeneity {
  public:
   HeterogeneityDistance() = delete;
 
-  HeterogeneityDistance(const HeterogeneityParams &params,
-                        const Eigen::MatrixXd &map);
+  explicit HeterogeneityDistance(const HeterogeneityParams &params);
 
-  Eigen::VectorXd CalculateCost(const geometry_msgs::Point &agent_position,
-                                const Eigen::VectorXd &distance) override;
+  bool GetTanhCostTerm(const double &weight,
+                       TanhCostTerm &term) const override;
 };
 }  // namespace partition
 }  // namespace sampling
\ No newline at end of file
@@ -12,11 +12,10 @@ class HeterogeneityDistanceDepedent : public Heterogeneity {
  public:
   HeterogeneityDistanceDepedent() = delete;
 
-  HeterogeneityDistanceDepedent(const HeterogeneityParams &params,
-                                const Eigen::MatrixXd &map);
+  explicit HeterogeneityDistanceDepedent(const HeterogeneityParams &params);
 
-  Eigen::VectorXd CalculateCost(const geometry_msgs::Point &agent_position,
-                                const Eigen::VectorXd &distance) override;
+  bool GetTanhCostTerm(const double &weight,
+                       TanhCostTerm &term) const override;
 };
 }  // namespace partition
 }  // namespace sampling
\ No newline at end of file
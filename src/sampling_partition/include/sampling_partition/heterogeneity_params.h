@@ -8,17 +8,25 @@
 namespace sampling {
 namespace partition {
 
+enum HeterogeneityType { DISTANCE, SPEED, BATTERY_LIFE, TRAVERSABILITY };
+
 class HeterogeneityParams {
  public:
   HeterogeneityParams(){};
 
   std::string heterogeneity_type;
 
+  // Parsed once from heterogeneity_type
+  HeterogeneityType type = DISTANCE;
+
   double heterogeneity_primitive;
 
   std::vector<geometry_msgs::Point> control_area_center;
 
   std::vector<double> control_area_radius;
+
+  // Use the bounded-error tanh approximation instead of std::tanh
+  bool fast_math = false;
 };
 }  // namespace partition
 }  // namespace sampling
\ No newline at end of file
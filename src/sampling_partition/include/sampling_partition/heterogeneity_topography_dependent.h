@@ -12,14 +12,14 @@ class HeterogeneityTopographyDepedent : public Heterogeneity {
  public:
   HeterogeneityTopographyDepedent() = delete;
 
+  /// Control areas are looked up in map_index, the index of the map rows
   HeterogeneityTopographyDepedent(const HeterogeneityParams &params,
-                                  const Eigen::MatrixXd &map);
+                                  const utils::GridIndex &map_index);
 
-  Eigen::VectorXd CalculateCost(const geometry_msgs::Point &agent_position,
-                                const Eigen::VectorXd &distance) override;
+  const Eigen::ArrayXd *GetStaticCost() const override;
 
  private:
-  Eigen::VectorXd topography_cost_;
+  Eigen::ArrayXd topography_cost_;
 };
 }  // namespace partition
 }  // namespace sampling
\ No newline at end of file
@@ -7,18 +7,54 @@
 #include <geometry_msgs/Point.h>
 
 #include <Eigen/Dense>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "sampling_msgs/AgentLocation.h"
+#include "sampling_partition/geodesic_distance.h"
 #include "sampling_partition/heterogeneity.h"
 #include "sampling_partition/weighted_voronoi_partition_params.h"
+#include "sampling_utils/thread_pool.h"
 
 namespace sampling {
 namespace partition {
 
+// Cached cost columns are reused while the agent stays in the same cell of
+// this size
+const double KCostCacheResolution_m = 0.01;
+// Partitions are updated agent by agent while at most this fraction of the
+// agents moved since the previous partition, recomputed otherwise
+const double KIncrementalPartitionMaxMovedRatio = 0.5;
+// Map cells ranked per thread pool task
+const int KPartitionChunkSize = 4096;
+// Geodesic distances from an earlier map cell are reused while the agent's
+// cell is within this many cell spacings of path from it, which makes them
+// longer by at most about twice that
+const double KGeodesicReuseSpacings = 3.0;
+
+/// Ownership of every map cell for one set of agent locations
+struct PartitionResult {
+  // Increases every time the partition is recomputed
+  int version;
+
+  // Agents in the order of the locations the partition was computed for
+  std::vector<std::string> agent_ids;
+
+  // Positions quantized by KCostCacheResolution_m
+  std::vector<std::pair<long long, long long>> position_keys;
+
+  // Index into agent_ids for every map cell, agent_ids.size() if no agent
+  // is cheaper than KCutOffCost
+  std::vector<int> owner;
+
+  std::unordered_map<std::string, std::vector<int>> agent_cells;
+};
+
 class WeightedVoronoiPartition {
  public:
   WeightedVoronoiPartition() = delete;
@@ -27,6 +63,21 @@ class WeightedVoronoiPartition {
       const std::vector<std::string> &agent_ids, const Eigen::MatrixXd &map,
       ros::NodeHandle &ph);
 
+  /// heterogeneity_param_map holds the heterogeneities of every agent in the
+  /// order of params.heterogenities, params.fast_math applies to all of
+  /// them.
+  static std::unique_ptr<WeightedVoronoiPartition> MakeUnique(
+      const WeightedVoronoiPartitionParam &params,
+      const std::unordered_map<std::string, std::vector<HeterogeneityParams>>
+          &heterogeneity_param_map,
+      const Eigen::MatrixXd &map);
+
+  /// Partition for the given locations. It is computed once per set of
+  /// (quantized) locations and shared by every caller until an agent moves
+  /// or the set of agents changes. Returns nullptr on failure.
+  std::shared_ptr<const PartitionResult> GetPartition(
+      const std::vector<sampling_msgs::AgentLocation> &location);
+
   bool ComputePartitionForAgent(
       const std::string &agent_id,
       const std::vector<sampling_msgs::AgentLocation> &location,
@@ -36,6 +87,15 @@ class WeightedVoronoiPartition {
       const std::vector<sampling_msgs::AgentLocation> &location,
       std::vector<int> &index_for_map);
 
+  /// Heterogeneity cost of agent_id for moving from position to each map
+  /// cell of cells, weighted as in the partition. Moves follow geodesic
+  /// distances when they are enabled and are straight otherwise, cells the
+  /// agent cannot reach cost infinity. Thread safe, false for an unknown
+  /// agent or cell.
+  bool GetTravelCost(const std::string &agent_id,
+                     const geometry_msgs::Point &position,
+                     const std::vector<int> &cells, std::vector<double> &cost);
+
  private:
   WeightedVoronoiPartition(
       const WeightedVoronoiPartitionParam &params,
@@ -43,15 +103,120 @@ class WeightedVoronoiPartition {
           &heterogeneity_param_map,
       const Eigen::MatrixXd &map);
 
-  Eigen::VectorXd CalculateEuclideanDistance(const geometry_msgs::Point &point,
-                                             const Eigen::MatrixXd &map);
+  struct CostColumn {
+    // Agent position quantized by KCostCacheResolution_m
+    long long key_x;
+
+    long long key_y;
+
+    std::shared_ptr<const Eigen::ArrayXd> cost;
+
+    // Map cell the geodesic distances are from, -1 without them
+    int source_cell = -1;
+
+    std::shared_ptr<const Eigen::ArrayXd> geodesic_distance;
+  };
+
+  /// Weighted sum of all heterogeneity costs of one agent over the map,
+  /// recomputed only when the agent moved since the cached column.
+  std::shared_ptr<const Eigen::ArrayXd> GetCostColumn(
+      const sampling_msgs::AgentLocation &agent_info);
+
+  /// Geodesic distances of the agent at position, to which source_offset
+  /// is added. The field of cached is reused while the map cell of position
+  /// is within KGeodesicReuseSpacings of its source, source_offset is then
+  /// the path length from there. Otherwise the field is recomputed from the
+  /// cell of position, only up to targets if there are any.
+  std::shared_ptr<const Eigen::ArrayXd> GetGeodesicDistance(
+      const std::string &agent_id, const geometry_msgs::Point &position,
+      const CostColumn &cached, const std::vector<int> &targets,
+      int &source_cell, double &source_offset) const;
+
+  /// Shortest path lengths of the agent from source_cell, only through cells
+  /// where its static cost is below KCutOffCost. Every call is a full
+  /// Dijkstra search, the field is never updated incrementally. With
+  /// targets, the search stops once their distances are final.
+  std::shared_ptr<const Eigen::ArrayXd> RecomputeGeodesicDistance(
+      const std::string &agent_id, const int &source_cell,
+      const std::vector<int> &targets = std::vector<int>()) const;
+
+  std::pair<long long, long long> QuantizePosition(
+      const geometry_msgs::Point &position) const;
+
+  /// Index into location of the cheapest agent for every map cell, or
+  /// location.size() if all costs are above KCutOffCost. With moved_agents,
+  /// only those agents are re-ranked against the ranking of the previous
+  /// partition, which must be for the same agents. Otherwise every cell is
+  /// ranked from scratch.
+  bool ComputeCellOwners(
+      const std::vector<sampling_msgs::AgentLocation> &location,
+      const std::vector<int> *moved_agents, std::vector<int> &owner);
+
+  /// Strict order of (cost, agent) pairs, the lower agent wins a tie
+  static bool IsCheaper(const double &cost, const int &agent,
+                        const double &other_cost, const int &other_agent);
+
+  /// Ranks all agents for cell i
+  void RankCell(const std::vector<const Eigen::ArrayXd *> &cost_columns,
+                const int &i);
+
+  /// Applies the new cost of agent k to the ranking of cell i, ranks the
+  /// cell from scratch only if k drops out of the top two.
+  void UpdateCellRanking(
+      const std::vector<const Eigen::ArrayXd *> &cost_columns, const int &k,
+      const int &i);
 
   WeightedVoronoiPartitionParam params_;
 
   std::unordered_map<std::string, std::vector<std::unique_ptr<Heterogeneity>>>
       heterogeneity_map_;
 
+  // Position dependent heterogeneity costs per agent, weights included
+  std::unordered_map<std::string, std::vector<TanhCostTerm>> tanh_cost_terms_;
+
+  // Weighted sum of the position independent heterogeneity costs per agent
+  std::unordered_map<std::string, std::shared_ptr<const Eigen::ArrayXd>>
+      static_cost_;
+
   Eigen::MatrixXd map_;
+
+  // Structure of arrays copy of the map coordinates for the cost kernel
+  Eigen::ArrayXd map_x_;
+
+  Eigen::ArrayXd map_y_;
+
+  // Only built with params_.geodesic_distance
+  std::unique_ptr<GeodesicDistanceGraph> geodesic_graph_;
+
+  std::unordered_map<std::string, CostColumn> cost_cache_;
+
+  // Goal requests and visualization may compute partitions concurrently
+  std::mutex cost_cache_mutex_;
+
+  std::shared_ptr<const PartitionResult> partition_;
+
+  /// Cheapest and second cheapest agent of every cell for partition_, ties
+  /// go to the lower agent index as in a plain argmin. Agents are indices
+  /// into partition_->agent_ids, -1 with infinite cost if there is none.
+  struct CellRanking {
+    std::vector<int> best_agent;
+
+    Eigen::ArrayXd best_cost;
+
+    std::vector<int> second_agent;
+
+    Eigen::ArrayXd second_cost;
+  };
+
+  CellRanking ranking_;
+
+  // Ranks disjoint chunks of cells in parallel
+  std::unique_ptr<utils::ThreadPool> thread_pool_;
+
+  // Held while a partition is looked up or computed, so concurrent callers
+  // with the same locations wait for one computation instead of repeating
+  // it
+  std::mutex partition_mutex_;
 };
 }  // namespace partition
 }  // namespace sampling
\ No newline at end of file
@@ -9,6 +9,8 @@ namespace sampling {
 namespace partition {
 
 const double KCutOffCost = 100.0;
+// Non-positive uses all hardware threads
+const int KPartitionThreads = 0;
 
 class WeightedVoronoiPartitionParam {
  public:
@@ -18,9 +20,21 @@ class WeightedVoronoiPartitionParam {
 
   std::unordered_set<std::string> agent_ids;
 
+  // Static heterogeneities (TRAVERSABILITY) must come after the position
+  // dependent ones
   std::vector<std::string> heterogenities;
 
   std::vector<double> weight_factor;
+
+  // Optional, evaluates tanh costs with utils::FastTanh
+  bool fast_math;
+
+  // Optional, distances are shortest paths around the cells an agent cannot
+  // take (static cost at or above KCutOffCost) instead of straight lines
+  bool geodesic_distance;
+
+  // Optional, threads ranking the map cells
+  int num_threads;
 };
 }  // namespace partition
 }  // namespace sampling
\ No newline at end of file
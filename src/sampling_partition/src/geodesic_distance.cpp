@@ -0,0 +1,136 @@
+#include "sampling_partition/geodesic_distance.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+
+namespace sampling {
+namespace partition {
+
+GeodesicDistanceGraph::GeodesicDistanceGraph(const Eigen::MatrixXd &map)
+    : index_(map), spacing_(0.0) {
+  const int num_cells = map.rows();
+  std::vector<int> cells;
+
+  // Closest other cell, searched in growing discs
+  std::vector<double> closest;
+  closest.reserve(num_cells);
+  double search_radius = 0.0;
+  if (num_cells > 1) {
+    const double width = map.col(0).maxCoeff() - map.col(0).minCoeff();
+    const double height = map.col(1).maxCoeff() - map.col(1).minCoeff();
+    search_radius = std::max(width, height) / std::sqrt(double(num_cells));
+  }
+  for (int i = 0; i < num_cells && search_radius > 0.0; ++i) {
+    double min_distance = std::numeric_limits<double>::infinity();
+    for (double radius = search_radius; std::isinf(min_distance);
+         radius *= 2.0) {
+      index_.RadiusSearch(map(i, 0), map(i, 1), radius, cells);
+      for (const int &j : cells) {
+        if (j == i) continue;
+        const double distance = (map.row(i) - map.row(j)).norm();
+        if (distance > 0.0) min_distance = std::min(min_distance, distance);
+      }
+      if (int(cells.size()) == num_cells) break;
+    }
+    if (!std::isinf(min_distance)) closest.push_back(min_distance);
+  }
+  if (!closest.empty()) {
+    std::nth_element(closest.begin(), closest.begin() + closest.size() / 2,
+                     closest.end());
+    spacing_ = closest[closest.size() / 2];
+  }
+
+  edge_start_.assign(num_cells + 1, 0);
+  guard_start_.push_back(0);
+  if (spacing_ <= 0.0) return;
+  std::vector<int> guards;
+  for (int i = 0; i < num_cells; ++i) {
+    index_.RadiusSearch(map(i, 0), map(i, 1),
+                        KGeodesicConnectionSpacing * spacing_, cells);
+    std::sort(cells.begin(), cells.end());
+    for (const int &j : cells) {
+      if (j == i) continue;
+      edge_target_.push_back(j);
+      edge_length_.push_back((map.row(i) - map.row(j)).norm());
+      const Eigen::RowVector2d midpoint = 0.5 * (map.row(i) + map.row(j));
+      index_.RadiusSearch(midpoint(0), midpoint(1),
+                          KGeodesicGuardSpacing * spacing_, guards);
+      for (const int &k : guards) {
+        if (k != i && k != j) guard_cells_.push_back(k);
+      }
+      guard_start_.push_back(guard_cells_.size());
+    }
+    edge_start_[i + 1] = edge_target_.size();
+  }
+}
+
+int GeodesicDistanceGraph::GetSourceCell(
+    const geometry_msgs::Point &position) const {
+  return index_.NearestSearch(position.x, position.y);
+}
+
+void GeodesicDistanceGraph::ComputeDistance(const int &source_cell,
+                                            const std::vector<bool> &passable,
+                                            Eigen::ArrayXd &distance) const {
+  ComputeDistance(source_cell, passable, std::vector<int>(), distance);
+}
+
+void GeodesicDistanceGraph::ComputeDistance(const int &source_cell,
+                                            const std::vector<bool> &passable,
+                                            const std::vector<int> &targets,
+                                            Eigen::ArrayXd &distance) const {
+  const int num_cells = edge_start_.size() - 1;
+  distance.setConstant(num_cells, std::numeric_limits<double>::infinity());
+  if (source_cell < 0 || source_cell >= num_cells) return;
+
+  // Without targets every cell is settled
+  std::vector<bool> is_target;
+  int num_unsettled = 0;
+  if (!targets.empty()) {
+    is_target.assign(num_cells, false);
+    for (const int &target : targets) {
+      if (target < 0 || target >= num_cells || is_target[target]) continue;
+      is_target[target] = true;
+      ++num_unsettled;
+    }
+  }
+
+  // Dijkstra with lazy deletion of outdated queue entries
+  typedef std::pair<double, int> QueueEntry;
+  std::priority_queue<QueueEntry, std::vector<QueueEntry>,
+                      std::greater<QueueEntry>>
+      queue;
+  distance(source_cell) = 0.0;
+  queue.emplace(0.0, source_cell);
+  while (!queue.empty()) {
+    const QueueEntry entry = queue.top();
+    queue.pop();
+    const int i = entry.second;
+    if (entry.first > distance(i)) continue;
+    if (!is_target.empty() && is_target[i] && --num_unsettled == 0) break;
+    for (int e = edge_start_[i]; e < edge_start_[i + 1]; ++e) {
+      const int j = edge_target_[e];
+      const double candidate = entry.first + edge_length_[e];
+      if (candidate >= distance(j) || !passable[j]) continue;
+      bool is_blocked = false;
+      for (int g = guard_start_[e]; g < guard_start_[e + 1]; ++g) {
+        if (!passable[guard_cells_[g]]) {
+          is_blocked = true;
+          break;
+        }
+      }
+      if (is_blocked) continue;
+      distance(j) = candidate;
+      queue.emplace(candidate, j);
+    }
+  }
+}
+
+double GeodesicDistanceGraph::GetSpacing() const { return spacing_; }
+
+}  // namespace partition
+}  // namespace sampling
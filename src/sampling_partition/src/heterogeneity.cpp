@@ -2,18 +2,77 @@
 
 #include <math.h> /* sqrt */
 
+#include <algorithm>
+
 #include "sampling_partition/heterogeneity_distance.h"
 #include "sampling_partition/heterogeneity_distance_dependent.h"
 #include "sampling_partition/heterogeneity_topography_dependent.h"
+#include "sampling_utils/fast_math.h"
 
 namespace sampling {
 namespace partition {
 
-Heterogeneity::Heterogeneity(const HeterogeneityParams &params,
-                             const Eigen::MatrixXd &map)
-    : params_(params), map_(map) {}
+bool ParseHeterogeneityType(const std::string &name, HeterogeneityType &type) {
+  if (KHomogeneityDistance.compare(name) == 0)
+    type = DISTANCE;
+  else if (KHeterogeneitySpeed.compare(name) == 0)
+    type = SPEED;
+  else if (KHeterogeneityBatteryLife.compare(name) == 0)
+    type = BATTERY_LIFE;
+  else if (KHeterogeneityTraversability.compare(name) == 0)
+    type = TRAVERSABILITY;
+  else
+    return false;
+  return true;
+}
+
+bool IsStaticHeterogeneity(const HeterogeneityType &type) {
+  return type == TRAVERSABILITY;
+}
+
+void AccumulateTanhCost(const TanhCostTerm &term,
+                        const Eigen::Ref<const Eigen::ArrayXd> &distance,
+                        Eigen::Ref<Eigen::ArrayXd> cost) {
+  if (!term.fast_math) {
+    cost += term.weight * ((distance * term.scale).tanh() + term.offset);
+    return;
+  }
+  // Stack buffer, the fused kernel hands in one block at a time
+  Eigen::Array<double, Eigen::Dynamic, 1, 0, KCostKernelBlockSize, 1> value;
+  for (int i = 0; i < distance.size(); i += KCostKernelBlockSize) {
+    const int size = std::min<int>(KCostKernelBlockSize, distance.size() - i);
+    value = distance.segment(i, size) * term.scale;
+    utils::FastTanh(value);
+    cost.segment(i, size) += term.weight * (value + term.offset);
+  }
+}
+
+std::unique_ptr<Heterogeneity> Heterogeneity::MakeUnique(
+    const HeterogeneityParams &params, const utils::GridIndex &map_index) {
+  switch (params.type) {
+    case DISTANCE:
+      return std::make_unique<HeterogeneityDistance>(params);
+    case SPEED:
+    case BATTERY_LIFE:
+      return std::make_unique<HeterogeneityDistanceDepedent>(params);
+    case TRAVERSABILITY:
+      return std::make_unique<HeterogeneityTopographyDepedent>(params,
+                                                               map_index);
+  }
+  return nullptr;
+}
+
+Heterogeneity::Heterogeneity(const HeterogeneityParams &params)
+    : params_(params) {}
+
+const Eigen::ArrayXd *Heterogeneity::GetStaticCost() const {
+  return nullptr;
+}
 
-std::string Heterogeneity::GetType() { return params_.heterogeneity_type; }
+bool Heterogeneity::GetTanhCostTerm(const double & /*weight*/,
+                                    TanhCostTerm & /*term*/) const {
+  return false;
+}
 
 }  // namespace partition
 }  // namespace sampling
\ No newline at end of file
@@ -5,17 +5,17 @@
 namespace sampling {
 namespace partition {
 
-Eigen::VectorXd HeterogeneityDistance::CalculateCost(
-    const geometry_msgs::Point &agent_position,
-    const Eigen::VectorXd &distance) {
-  Eigen::VectorXd cost = distance.array() * KDistancePrimitive;
-  cost = cost.array().tanh();
-  return cost;
+bool HeterogeneityDistance::GetTanhCostTerm(const double &weight,
+                                            TanhCostTerm &term) const {
+  term.scale = KDistancePrimitive;
+  term.offset = 0.0;
+  term.weight = weight;
+  term.fast_math = params_.fast_math;
+  return true;
 }
 
-HeterogeneityDistance::HeterogeneityDistance(const HeterogeneityParams &params,
-                                             const Eigen::MatrixXd &map)
-    : Heterogeneity(params, map) {}
+HeterogeneityDistance::HeterogeneityDistance(const HeterogeneityParams &params)
+    : Heterogeneity(params) {}
 
 }  // namespace partition
 }  // namespace sampling
\ No newline at end of file
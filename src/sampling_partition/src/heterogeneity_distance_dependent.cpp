@@ -5,21 +5,19 @@
 namespace sampling {
 namespace partition {
 
-Eigen::VectorXd HeterogeneityDistanceDepedent::CalculateCost(
-    const geometry_msgs::Point &agent_position,
-    const Eigen::VectorXd &distance) {
-  Eigen::VectorXd cost = distance.array() * params_.heterogeneity_primitive;
-  cost = cost.array().tanh();
-  if (params_.heterogeneity_primitive >= 0) {
-    return cost;
-  } else {
-    return cost.array() + 1.0;
-  }
+bool HeterogeneityDistanceDepedent::GetTanhCostTerm(const double &weight,
+                                                    TanhCostTerm &term) const {
+  term.scale = params_.heterogeneity_primitive;
+  // Negative primitives are shifted to stay in [0, 1)
+  term.offset = params_.heterogeneity_primitive >= 0 ? 0.0 : 1.0;
+  term.weight = weight;
+  term.fast_math = params_.fast_math;
+  return true;
 }
 
 HeterogeneityDistanceDepedent::HeterogeneityDistanceDepedent(
-    const HeterogeneityParams &params, const Eigen::MatrixXd &map)
-    : Heterogeneity(params, map) {}
+    const HeterogeneityParams &params)
+    : Heterogeneity(params) {}
 
 }  // namespace partition
 }  // namespace sampling
\ No newline at end of file
@@ -2,32 +2,30 @@
 
 #include <math.h>
 
+#include <vector>
+
 namespace sampling {
 namespace partition {
 
-Eigen::VectorXd HeterogeneityTopographyDepedent::CalculateCost(
-    const geometry_msgs::Point &agent_position,
-    const Eigen::VectorXd &distance) {
-  return topography_cost_;
+const Eigen::ArrayXd *HeterogeneityTopographyDepedent::GetStaticCost() const {
+  return &topography_cost_;
 }
 
 HeterogeneityTopographyDepedent::HeterogeneityTopographyDepedent(
-    const HeterogeneityParams &params, const Eigen::MatrixXd &map)
-    : Heterogeneity(params, map),
-      topography_cost_(Eigen::VectorXd::Zero(map.rows())) {
-  for (int i = 0; i < params_.control_area_center.size(); ++i) {
-    geometry_msgs::Point center = params_.control_area_center[i];
-    Eigen::MatrixXd distance_map(map_.rows(), map_.cols());
-    distance_map.col(0).array() = map_.col(0).array() - center.x;
-    distance_map.col(1).array() = map_.col(1).array() - center.y;
-    Eigen::VectorXd distance = distance_map.rowwise().norm();
-    for (int j = 0; j < distance.size(); ++j) {
-      if (distance(j) <= params_.control_area_radius[i]) {
-        topography_cost_(j) = params_.heterogeneity_primitive;
-      }
+    const HeterogeneityParams &params, const utils::GridIndex &map_index)
+    : Heterogeneity(params),
+      topography_cost_(Eigen::ArrayXd::Zero(map_index.Size())) {
+  std::vector<int> cells;
+  const int num_areas = params_.control_area_center.size();
+  for (int i = 0; i < num_areas; ++i) {
+    const geometry_msgs::Point &center = params_.control_area_center[i];
+    map_index.RadiusSearch(center.x, center.y,
+                           params_.control_area_radius[i], cells);
+    for (const int &j : cells) {
+      topography_cost_(j) = params_.heterogeneity_primitive;
     }
   }
 }
 
 }  // namespace partition
-}  // namespace sampling
\ No newline at end of file
+}  // namespace sampling
@@ -1,8 +1,9 @@
 #include "sampling_partition/weighted_voronoi_partition.h"
 
-#include "sampling_partition/heterogeneity_distance.h"
-#include "sampling_partition/heterogeneity_distance_dependent.h"
-#include "sampling_partition/heterogeneity_topography_dependent.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 #include "sampling_utils/utils.h"
 
 namespace sampling {
@@ -99,22 +100,7 @@ WeightedVoronoiPartition::MakeUniqueFromRosParam(
       params.heterogeneity_primitive = heterogeneity_primitive[j];
       params.control_area_center = control_area_center;
       params.control_area_radius = control_area_radius;
-      std::unique_ptr<Heterogeneity> hetero_ptr = nullptr;
-      if (KHomogeneityDistance.compare(params.heterogeneity_type) == 0)
-        hetero_ptr = std::make_unique<HeterogeneityDistance>(params, map);
-      else if (KHeterogeneitySpeed.compare(params.heterogeneity_type) == 0)
-        hetero_ptr =
-            std::make_unique<HeterogeneityDistanceDepedent>(params, map);
-      else if (KHeterogeneityBatteryLife.compare(params.heterogeneity_type) ==
-               0)
-        hetero_ptr =
-            std::make_unique<HeterogeneityDistanceDepedent>(params, map);
-      else if (KHeterogeneityTraversability.compare(
-                   params.heterogeneity_type) == 0)
-        hetero_ptr =
-            std::make_unique<HeterogeneityTopographyDepedent>(params, map);
-
-      if (hetero_ptr == nullptr) {
+      if (!ParseHeterogeneityType(params.heterogeneity_type, params.type)) {
         ROS_ERROR_STREAM("Error information of heterogeneity : "
                          << params.heterogeneity_type
                          << " for agent : " << agent_id);
@@ -123,8 +109,77 @@ WeightedVoronoiPartition::MakeUniqueFromRosParam(
       heterogeneity_param_map[agent_id].push_back(params);
     }
   }
-  return std::unique_ptr<WeightedVoronoiPartition>(new WeightedVoronoiPartition(
-      partiton_params, heterogeneity_param_map, map));
+  return MakeUnique(partiton_params, heterogeneity_param_map, map);
+}
+
+std::unique_ptr<WeightedVoronoiPartition> WeightedVoronoiPartition::MakeUnique(
+    const WeightedVoronoiPartitionParam &params,
+    const std::unordered_map<std::string, std::vector<HeterogeneityParams>>
+        &heterogeneity_param_map,
+    const Eigen::MatrixXd &map) {
+  for (const auto &agent_params : heterogeneity_param_map) {
+    if (agent_params.second.size() != params.heterogenities.size() ||
+        params.weight_factor.size() != params.heterogenities.size()) {
+      ROS_ERROR_STREAM("Heterogeneities of agent : "
+                       << agent_params.first
+                       << " do NOT match the partition params!");
+      return nullptr;
+    }
+  }
+  return std::unique_ptr<WeightedVoronoiPartition>(
+      new WeightedVoronoiPartition(params, heterogeneity_param_map, map));
+}
+
+std::shared_ptr<const PartitionResult> WeightedVoronoiPartition::GetPartition(
+    const std::vector<sampling_msgs::AgentLocation> &location) {
+  std::lock_guard<std::mutex> lock(partition_mutex_);
+  // Compared in place, a cache hit allocates nothing
+  bool is_cached =
+      partition_ != nullptr && partition_->agent_ids.size() == location.size();
+  for (int k = 0; is_cached && k < location.size(); ++k) {
+    is_cached = partition_->agent_ids[k] == location[k].agent_id &&
+                partition_->position_keys[k] ==
+                    QuantizePosition(location[k].position);
+  }
+  if (is_cached) return partition_;
+
+  std::vector<std::string> agent_ids;
+  std::vector<std::pair<long long, long long>> position_keys;
+  agent_ids.reserve(location.size());
+  position_keys.reserve(location.size());
+  for (const sampling_msgs::AgentLocation &agent_info : location) {
+    agent_ids.push_back(agent_info.agent_id);
+    position_keys.push_back(QuantizePosition(agent_info.position));
+  }
+
+  // Cost columns of agents that did not move are unchanged, so a partition
+  // for the same agents only needs the moved agents re-ranked
+  std::vector<int> moved_agents;
+  bool is_incremental =
+      partition_ != nullptr && partition_->agent_ids == agent_ids;
+  if (is_incremental) {
+    for (int k = 0; k < position_keys.size(); ++k) {
+      if (position_keys[k] != partition_->position_keys[k])
+        moved_agents.push_back(k);
+    }
+    is_incremental = moved_agents.size() <=
+                     KIncrementalPartitionMaxMovedRatio * agent_ids.size();
+  }
+
+  std::shared_ptr<PartitionResult> partition =
+      std::make_shared<PartitionResult>();
+  if (!ComputeCellOwners(location, is_incremental ? &moved_agents : nullptr,
+                         partition->owner))
+    return nullptr;
+  partition->version = partition_ == nullptr ? 0 : partition_->version + 1;
+  for (int i = 0; i < partition->owner.size(); ++i) {
+    if (partition->owner[i] < location.size())
+      partition->agent_cells[agent_ids[partition->owner[i]]].push_back(i);
+  }
+  partition->agent_ids.swap(agent_ids);
+  partition->position_keys.swap(position_keys);
+  partition_ = partition;
+  return partition_;
 }
 
 bool WeightedVoronoiPartition::ComputePartitionForAgent(
@@ -132,33 +187,11 @@ bool WeightedVoronoiPartition::ComputePartitionForAgent(
     const std::vector<sampling_msgs::AgentLocation> &location,
     std::vector<int> &partition_index) {
   partition_index.clear();
-  Eigen::MatrixXd cost_map =
-      Eigen::MatrixXd::Zero(map_.rows(), location.size());
-  for (int i = 0; i < location.size(); ++i) {
-    sampling_msgs::AgentLocation agent_info = location.at(i);
-    if (!heterogeneity_map_.count(agent_info.agent_id)) {
-      ROS_ERROR_STREAM(
-          "Failed to do partition for unknown agent : " << agent_info.agent_id);
-      return false;
-    }
-    const Eigen::VectorXd distance =
-        CalculateEuclideanDistance(agent_info.position, map_);
-    for (int j = 0; j < heterogeneity_map_[agent_info.agent_id].size(); ++j) {
-      Eigen::VectorXd heterogeneity_cost =
-          params_.weight_factor[j] *
-          heterogeneity_map_[agent_info.agent_id][j]->CalculateCost(
-              agent_info.position, distance);
-      cost_map.col(i).array() =
-          cost_map.col(i).array() + heterogeneity_cost.array();
-    }
-  }
-  for (int i = 0; i < map_.rows(); ++i) {
-    Eigen::MatrixXd::Index index;
-    cost_map.row(i).minCoeff(&index);
-    if (agent_id.compare(location[(int)index].agent_id) == 0 &&
-        cost_map(i, index) < KCutOffCost)
-      partition_index.push_back(i);
-  }
+  const std::shared_ptr<const PartitionResult> partition =
+      GetPartition(location);
+  if (partition == nullptr) return false;
+  const auto it = partition->agent_cells.find(agent_id);
+  if (it != partition->agent_cells.end()) partition_index = it->second;
   return true;
 }
 
@@ -166,34 +199,56 @@ bool WeightedVoronoiPartition::ComputePartitionForMap(
     const std::vector<sampling_msgs::AgentLocation> &location,
     std::vector<int> &index_for_map) {
   index_for_map.clear();
-  Eigen::MatrixXd cost_map =
-      Eigen::MatrixXd::Zero(map_.rows(), location.size());
-  for (int i = 0; i < location.size(); ++i) {
-    sampling_msgs::AgentLocation agent_info = location.at(i);
-    if (!heterogeneity_map_.count(agent_info.agent_id)) {
-      ROS_ERROR_STREAM(
-          "Failed to do partition for unknown agent : " << agent_info.agent_id);
-      return false;
+  const std::shared_ptr<const PartitionResult> partition =
+      GetPartition(location);
+  if (partition == nullptr) return false;
+  index_for_map = partition->owner;
+  return true;
+}
+
+bool WeightedVoronoiPartition::GetTravelCost(
+    const std::string &agent_id, const geometry_msgs::Point &position,
+    const std::vector<int> &cells, std::vector<double> &cost) {
+  const auto terms = tanh_cost_terms_.find(agent_id);
+  if (terms == tanh_cost_terms_.end()) return false;
+  for (const int &cell : cells) {
+    if (cell < 0 || cell >= map_.rows()) return false;
+  }
+
+  // Geodesic distances of the cached cost column are reused near the
+  // agent's position
+  std::shared_ptr<const Eigen::ArrayXd> geodesic_distance;
+  double source_offset = 0.0;
+  if (geodesic_graph_ != nullptr) {
+    CostColumn cached;
+    {
+      std::lock_guard<std::mutex> lock(cost_cache_mutex_);
+      const auto it = cost_cache_.find(agent_id);
+      if (it != cost_cache_.end()) cached = it->second;
     }
-    const Eigen::VectorXd distance =
-        CalculateEuclideanDistance(agent_info.position, map_);
-    for (int j = 0; j < heterogeneity_map_[agent_info.agent_id].size(); ++j) {
-      Eigen::VectorXd heterogeneity_cost =
-          params_.weight_factor[j] *
-          heterogeneity_map_[agent_info.agent_id][j]->CalculateCost(
-              agent_info.position, distance);
-      cost_map.col(i).array() =
-          cost_map.col(i).array() + heterogeneity_cost.array();
-    }
-  }
-  index_for_map.resize(map_.rows());
-  for (int i = 0; i < map_.rows(); ++i) {
-    Eigen::MatrixXd::Index index;
-    cost_map.row(i).minCoeff(&index);
-    if (cost_map(i, index) < KCutOffCost)
-      index_for_map[i] = (int)index;
-    else
-      index_for_map[i] = (int)location.size();
+    int source_cell;
+    geodesic_distance = GetGeodesicDistance(agent_id, position, cached, cells,
+                                            source_cell, source_offset);
+  }
+
+  const Eigen::ArrayXd &static_cost = *static_cost_.at(agent_id);
+  cost.resize(cells.size());
+  for (int k = 0; k < cells.size(); ++k) {
+    const int cell = cells[k];
+    if (geodesic_distance != nullptr &&
+        std::isinf((*geodesic_distance)(cell))) {
+      cost[k] = std::numeric_limits<double>::infinity();
+      continue;
+    }
+    const double distance =
+        geodesic_distance != nullptr
+            ? (*geodesic_distance)(cell) + source_offset
+            : std::hypot(map_x_(cell) - position.x, map_y_(cell) - position.y);
+    cost[k] = 0.0;
+    for (const TanhCostTerm &term : terms->second) {
+      cost[k] += term.weight * (std::tanh(distance * term.scale) + term.offset);
+    }
+    cost[k] += static_cost(cell);
   }
   return true;
 }
@@ -203,35 +258,296 @@ WeightedVoronoiPartition::WeightedVoronoiPartition(
     const std::unordered_map<std::string, std::vector<HeterogeneityParams>>
         &heterogeneity_param_map,
     const Eigen::MatrixXd &map)
-    : params_(params), map_(map) {
+    : params_(params),
+      map_(map),
+      map_x_(map.col(0).array()),
+      map_y_(map.col(1).array()),
+      thread_pool_(new utils::ThreadPool(params.num_threads)) {
   heterogeneity_map_.clear();
+  // One index of the map cells for the control areas of all agents
+  const utils::GridIndex map_index(map);
   for (auto it = heterogeneity_param_map.begin();
        it != heterogeneity_param_map.end(); ++it) {
     heterogeneity_map_[it->first].reserve(it->second.size());
-    for (const auto &param : it->second) {
-      if (KHomogeneityDistance.compare(param.heterogeneity_type) == 0)
-        heterogeneity_map_[it->first].push_back(
-            std::make_unique<HeterogeneityDistance>(param, map));
-      else if (KHeterogeneitySpeed.compare(param.heterogeneity_type) == 0)
-        heterogeneity_map_[it->first].push_back(
-            std::make_unique<HeterogeneityDistanceDepedent>(param, map));
-      else if (KHeterogeneityBatteryLife.compare(param.heterogeneity_type) == 0)
-        heterogeneity_map_[it->first].push_back(
-            std::make_unique<HeterogeneityDistanceDepedent>(param, map));
-      else if (KHeterogeneityTraversability.compare(param.heterogeneity_type) ==
-               0)
-        heterogeneity_map_[it->first].push_back(
-            std::make_unique<HeterogeneityTopographyDepedent>(param, map));
+    for (HeterogeneityParams param : it->second) {
+      param.fast_math = params_.fast_math;
+      heterogeneity_map_[it->first].push_back(
+          Heterogeneity::MakeUnique(param, map_index));
+    }
+  }
+
+  // Position dependent costs are evaluated from plain terms, static ones
+  // are summed below
+  for (auto it = heterogeneity_map_.begin(); it != heterogeneity_map_.end();
+       ++it) {
+    std::vector<TanhCostTerm> &terms = tanh_cost_terms_[it->first];
+    for (int j = 0; j < it->second.size(); ++j) {
+      TanhCostTerm term;
+      if (it->second[j]->GetTanhCostTerm(params_.weight_factor[j], term))
+        terms.push_back(term);
     }
   }
+
+  // Weighted static costs are summed once per agent, agents with the same
+  // sum share one column
+  std::vector<std::shared_ptr<const Eigen::ArrayXd>> static_columns;
+  for (auto it = heterogeneity_map_.begin(); it != heterogeneity_map_.end();
+       ++it) {
+    Eigen::ArrayXd static_cost = Eigen::ArrayXd::Zero(map.rows());
+    for (int j = 0; j < it->second.size(); ++j) {
+      const Eigen::ArrayXd *cost = it->second[j]->GetStaticCost();
+      if (cost != nullptr) static_cost += params_.weight_factor[j] * *cost;
+    }
+    for (const auto &column : static_columns) {
+      if ((*column == static_cost).all()) {
+        static_cost_[it->first] = column;
+        break;
+      }
+    }
+    if (!static_cost_.count(it->first)) {
+      static_columns.push_back(
+          std::make_shared<const Eigen::ArrayXd>(std::move(static_cost)));
+      static_cost_[it->first] = static_columns.back();
+    }
+  }
+
+  if (params_.geodesic_distance) {
+    geodesic_graph_ = std::make_unique<GeodesicDistanceGraph>(map);
+    ROS_INFO_STREAM("Geodesic distance graph with cell spacing : "
+                    << geodesic_graph_->GetSpacing());
+  }
 }
 
-Eigen::VectorXd WeightedVoronoiPartition::CalculateEuclideanDistance(
-    const geometry_msgs::Point &point, const Eigen::MatrixXd &map) {
-  Eigen::MatrixXd distance_map(map.rows(), map.cols());
-  distance_map.col(0).array() = map.col(0).array() - point.x;
-  distance_map.col(1).array() = map.col(1).array() - point.y;
-  return distance_map.rowwise().norm();
+std::shared_ptr<const Eigen::ArrayXd> WeightedVoronoiPartition::GetCostColumn(
+    const sampling_msgs::AgentLocation &agent_info) {
+  const std::pair<long long, long long> key =
+      QuantizePosition(agent_info.position);
+  CostColumn previous;
+  {
+    std::lock_guard<std::mutex> lock(cost_cache_mutex_);
+    const auto it = cost_cache_.find(agent_info.agent_id);
+    if (it != cost_cache_.end()) {
+      if (it->second.key_x == key.first && it->second.key_y == key.second)
+        return it->second.cost;
+      previous = it->second;
+    }
+  }
+
+  // Geodesic distances are only recomputed once the agent moved away from
+  // the cell they run from
+  std::shared_ptr<const Eigen::ArrayXd> geodesic_distance;
+  int source_cell = -1;
+  double source_offset = 0.0;
+  if (geodesic_graph_ != nullptr) {
+    geodesic_distance = GetGeodesicDistance(
+        agent_info.agent_id, agent_info.position, previous,
+        std::vector<int>(), source_cell, source_offset);
+  }
+
+  // Fused kernel: distance and all weighted heterogeneity costs are
+  // evaluated block by block with Eigen packet math, each cost is written
+  // once and no map sized temporary is allocated
+  const std::vector<TanhCostTerm> &terms =
+      tanh_cost_terms_.at(agent_info.agent_id);
+  const Eigen::ArrayXd &static_cost = *static_cost_.at(agent_info.agent_id);
+  const int num_cells = map_.rows();
+  std::shared_ptr<Eigen::ArrayXd> cost =
+      std::make_shared<Eigen::ArrayXd>(num_cells);
+  const double infinity = std::numeric_limits<double>::infinity();
+  Eigen::Array<double, KCostKernelBlockSize, 1> distance;
+  for (int start = 0; start < num_cells; start += KCostKernelBlockSize) {
+    const int size = std::min(KCostKernelBlockSize, num_cells - start);
+    if (geodesic_distance != nullptr) {
+      // Unreachable cells are given an infinite cost below, their distance
+      // is never used
+      const auto geodesic = geodesic_distance->segment(start, size);
+      distance.head(size) =
+          (geodesic < infinity).select(geodesic + source_offset, 0.0);
+    } else {
+      distance.head(size) =
+          ((map_x_.segment(start, size) - agent_info.position.x).square() +
+           (map_y_.segment(start, size) - agent_info.position.y).square())
+              .sqrt();
+    }
+    cost->segment(start, size).setZero();
+    for (const TanhCostTerm &term : terms) {
+      AccumulateTanhCost(term, distance.head(size),
+                         cost->segment(start, size));
+    }
+    // Added last, the params loader requires static heterogeneities to come
+    // last in the configuration, so the summation order is the configured
+    // one
+    cost->segment(start, size) += static_cost.segment(start, size);
+    // No agent gets a cell it cannot reach, whatever its heterogeneities
+    if (geodesic_distance != nullptr) {
+      cost->segment(start, size) =
+          (geodesic_distance->segment(start, size) < infinity)
+              .select(cost->segment(start, size), infinity);
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(cost_cache_mutex_);
+  CostColumn &column = cost_cache_[agent_info.agent_id];
+  column.key_x = key.first;
+  column.key_y = key.second;
+  column.cost = cost;
+  column.source_cell = source_cell;
+  column.geodesic_distance = geodesic_distance;
+  return cost;
+}
+
+std::shared_ptr<const Eigen::ArrayXd>
+WeightedVoronoiPartition::GetGeodesicDistance(
+    const std::string &agent_id, const geometry_msgs::Point &position,
+    const CostColumn &cached, const std::vector<int> &targets,
+    int &source_cell, double &source_offset) const {
+  const int cell = geodesic_graph_->GetSourceCell(position);
+  const double cell_offset =
+      std::hypot(map_x_(cell) - position.x, map_y_(cell) - position.y);
+  if (cached.geodesic_distance != nullptr) {
+    // Path length from the cached source, infinite if it is cut off
+    const double moved = (*cached.geodesic_distance)(cell);
+    if (moved <= KGeodesicReuseSpacings * geodesic_graph_->GetSpacing()) {
+      source_cell = cached.source_cell;
+      source_offset = moved + cell_offset;
+      return cached.geodesic_distance;
+    }
+  }
+  source_cell = cell;
+  source_offset = cell_offset;
+  return RecomputeGeodesicDistance(agent_id, cell, targets);
+}
+
+std::shared_ptr<const Eigen::ArrayXd>
+WeightedVoronoiPartition::RecomputeGeodesicDistance(
+    const std::string &agent_id, const int &source_cell,
+    const std::vector<int> &targets) const {
+  const Eigen::ArrayXd &static_cost = *static_cost_.at(agent_id);
+  std::vector<bool> passable(static_cost.size());
+  for (int i = 0; i < static_cost.size(); ++i) {
+    passable[i] = static_cost(i) < KCutOffCost;
+  }
+  std::shared_ptr<Eigen::ArrayXd> distance = std::make_shared<Eigen::ArrayXd>();
+  geodesic_graph_->ComputeDistance(source_cell, passable, targets, *distance);
+  return distance;
+}
+
+std::pair<long long, long long> WeightedVoronoiPartition::QuantizePosition(
+    const geometry_msgs::Point &position) const {
+  return std::make_pair(std::llround(position.x / KCostCacheResolution_m),
+                        std::llround(position.y / KCostCacheResolution_m));
+}
+
+bool WeightedVoronoiPartition::ComputeCellOwners(
+    const std::vector<sampling_msgs::AgentLocation> &location,
+    const std::vector<int> *moved_agents, std::vector<int> &owner) {
+  std::vector<std::shared_ptr<const Eigen::ArrayXd>> cost_columns;
+  cost_columns.reserve(location.size());
+  for (const sampling_msgs::AgentLocation &agent_info : location) {
+    if (!heterogeneity_map_.count(agent_info.agent_id)) {
+      ROS_ERROR_STREAM(
+          "Failed to do partition for unknown agent : " << agent_info.agent_id);
+      return false;
+    }
+    cost_columns.push_back(GetCostColumn(agent_info));
+  }
+  std::vector<const Eigen::ArrayXd *> columns;
+  columns.reserve(cost_columns.size());
+  for (const auto &column : cost_columns) columns.push_back(column.get());
+
+  const int num_cells = map_.rows();
+  if (moved_agents == nullptr) {
+    ranking_.best_agent.resize(num_cells);
+    ranking_.best_cost.resize(num_cells);
+    ranking_.second_agent.resize(num_cells);
+    ranking_.second_cost.resize(num_cells);
+  }
+  owner.resize(num_cells);
+
+  // Cells are independent, each task ranks one contiguous chunk
+  const int num_chunks =
+      (num_cells + KPartitionChunkSize - 1) / KPartitionChunkSize;
+  thread_pool_->ParallelFor(num_chunks, [&](int chunk) {
+    const int begin = chunk * KPartitionChunkSize;
+    const int end = std::min(num_cells, begin + KPartitionChunkSize);
+    if (moved_agents == nullptr) {
+      for (int i = begin; i < end; ++i) RankCell(columns, i);
+    } else {
+      for (const int &k : *moved_agents) {
+        for (int i = begin; i < end; ++i) UpdateCellRanking(columns, k, i);
+      }
+    }
+    for (int i = begin; i < end; ++i) {
+      owner[i] = ranking_.best_cost(i) < KCutOffCost ? ranking_.best_agent[i]
+                                                     : int(location.size());
+    }
+  });
+  return true;
+}
+
+bool WeightedVoronoiPartition::IsCheaper(const double &cost, const int &agent,
+                                         const double &other_cost,
+                                         const int &other_agent) {
+  return cost < other_cost || (cost == other_cost && agent < other_agent);
+}
+
+void WeightedVoronoiPartition::RankCell(
+    const std::vector<const Eigen::ArrayXd *> &cost_columns, const int &i) {
+  int best_agent = -1;
+  int second_agent = -1;
+  double best_cost = std::numeric_limits<double>::infinity();
+  double second_cost = best_cost;
+  for (int k = 0; k < cost_columns.size(); ++k) {
+    const double cost = (*cost_columns[k])(i);
+    if (cost < best_cost) {
+      second_agent = best_agent;
+      second_cost = best_cost;
+      best_agent = k;
+      best_cost = cost;
+    } else if (cost < second_cost) {
+      second_agent = k;
+      second_cost = cost;
+    }
+  }
+  ranking_.best_agent[i] = best_agent;
+  ranking_.best_cost(i) = best_cost;
+  ranking_.second_agent[i] = second_agent;
+  ranking_.second_cost(i) = second_cost;
+}
+
+void WeightedVoronoiPartition::UpdateCellRanking(
+    const std::vector<const Eigen::ArrayXd *> &cost_columns, const int &k,
+    const int &i) {
+  const double cost = (*cost_columns[k])(i);
+  int &best_agent = ranking_.best_agent[i];
+  int &second_agent = ranking_.second_agent[i];
+  double &best_cost = ranking_.best_cost(i);
+  double &second_cost = ranking_.second_cost(i);
+  if (best_agent == k) {
+    if (IsCheaper(cost, k, second_cost, second_agent))
+      best_cost = cost;
+    else
+      RankCell(cost_columns, i);
+  } else if (second_agent == k) {
+    if (IsCheaper(cost, k, best_cost, best_agent)) {
+      second_agent = best_agent;
+      second_cost = best_cost;
+      best_agent = k;
+      best_cost = cost;
+    } else if (cost <= second_cost) {
+      second_cost = cost;
+    } else {
+      RankCell(cost_columns, i);
+    }
+  } else if (IsCheaper(cost, k, best_cost, best_agent)) {
+    second_agent = best_agent;
+    second_cost = best_cost;
+    best_agent = k;
+    best_cost = cost;
+  } else if (IsCheaper(cost, k, second_cost, second_agent)) {
+    second_agent = k;
+    second_cost = cost;
+  }
 }
 
 }  // namespace partition
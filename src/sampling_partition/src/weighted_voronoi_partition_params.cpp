@@ -8,7 +8,10 @@
 namespace sampling {
 namespace partition {
 
-WeightedVoronoiPartitionParam::WeightedVoronoiPartitionParam() {}
+WeightedVoronoiPartitionParam::WeightedVoronoiPartitionParam()
+    : fast_math(false),
+      geodesic_distance(false),
+      num_threads(KPartitionThreads) {}
 
 bool WeightedVoronoiPartitionParam::LoadFromXML(
     const XmlRpc::XmlRpcValue& param) {
@@ -18,12 +21,52 @@ bool WeightedVoronoiPartitionParam::LoadFromXML(
     return false;
   }
 
+  // The partition adds the summed static costs after the position dependent
+  // ones, which only keeps the configured summation order if static
+  // heterogeneities come last
+  bool has_static = false;
+  for (const std::string& name : heterogenities) {
+    HeterogeneityType type;
+    if (!ParseHeterogeneityType(name, type)) {
+      ROS_ERROR_STREAM("Unknown heterogeneity : " << name);
+      return false;
+    }
+    if (has_static && !IsStaticHeterogeneity(type)) {
+      ROS_ERROR_STREAM("Heterogeneity " << name
+                                        << " must come before the static "
+                                           "heterogeneities!");
+      return false;
+    }
+    has_static = has_static || IsStaticHeterogeneity(type);
+  }
+
   if (!utils::GetParam(param, "weight_factor", weight_factor) ||
       weight_factor.size() != heterogenities.size()) {
     ROS_ERROR_STREAM(
         "Error loading weight factors for heterogeneous property!");
     return false;
   }
+
+  if (param.hasMember("fast_math") &&
+      !utils::GetParam(param, "fast_math", fast_math)) {
+    ROS_ERROR_STREAM(
+        "Error loading fast math mode for heterogeneous property!");
+    return false;
+  }
+
+  if (param.hasMember("geodesic_distance") &&
+      !utils::GetParam(param, "geodesic_distance", geodesic_distance)) {
+    ROS_ERROR_STREAM(
+        "Error loading geodesic distance mode for heterogeneous property!");
+    return false;
+  }
+
+  if (param.hasMember("num_threads") &&
+      !utils::GetParam(param, "num_threads", num_threads)) {
+    ROS_ERROR_STREAM(
+        "Error loading number of threads for heterogeneous property!");
+    return false;
+  }
   return true;
 }
 
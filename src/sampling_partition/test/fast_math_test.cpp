@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+
+#include <Eigen/Dense>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "sampling_partition/weighted_voronoi_partition.h"
+#include "sampling_utils/fast_math.h"
+
+namespace sampling {
+namespace partition {
+
+const int KFixtureGridSize = 120;
+const double KFixtureGridSpacing = 0.1;
+const int KFixtureAgents = 6;
+
+/// Cell owners of a partition of the fixture grid, which only depends on
+/// fast_math through the partition params
+std::vector<int> ComputeOwners(const bool &fast_math) {
+  const int num_cells = KFixtureGridSize * KFixtureGridSize;
+  Eigen::MatrixXd map(num_cells, 2);
+  for (int i = 0; i < num_cells; ++i) {
+    map(i, 0) = (i / KFixtureGridSize) * KFixtureGridSpacing;
+    map(i, 1) = (i % KFixtureGridSize) * KFixtureGridSpacing;
+  }
+
+  WeightedVoronoiPartitionParam params;
+  params.heterogenities = {"DISTANCE", "SPEED", "BATTERY_LIFE",
+                           "TRAVERSABILITY"};
+  params.weight_factor = {1.0, 0.5, 0.5, 2.0};
+  params.fast_math = fast_math;
+  std::unordered_map<std::string, std::vector<HeterogeneityParams>>
+      heterogeneity_param_map;
+  std::vector<sampling_msgs::AgentLocation> location(KFixtureAgents);
+  for (int a = 0; a < KFixtureAgents; ++a) {
+    const std::string agent_id = "agent_" + std::to_string(a);
+    params.agent_ids.insert(agent_id);
+    location[a].agent_id = agent_id;
+    location[a].position.x = (a * 37 % 12) * 1.0;
+    location[a].position.y = (a * 13 % 12) * 1.0;
+    for (int h = 0; h < params.heterogenities.size(); ++h) {
+      HeterogeneityParams heterogeneity;
+      heterogeneity.heterogeneity_type = params.heterogenities[h];
+      EXPECT_TRUE(ParseHeterogeneityType(heterogeneity.heterogeneity_type,
+                                         heterogeneity.type));
+      heterogeneity.heterogeneity_primitive = (a % 2 ? 0.3 : -0.2) * (h + 1);
+      geometry_msgs::Point center;
+      center.x = a * 2.0;
+      center.y = 5.0;
+      heterogeneity.control_area_center.push_back(center);
+      heterogeneity.control_area_radius.push_back(2.0);
+      heterogeneity_param_map[agent_id].push_back(heterogeneity);
+    }
+  }
+
+  const std::unique_ptr<WeightedVoronoiPartition> partition =
+      WeightedVoronoiPartition::MakeUnique(params, heterogeneity_param_map,
+                                           map);
+  std::vector<int> owner;
+  EXPECT_NE(partition, nullptr);
+  if (partition != nullptr) {
+    EXPECT_TRUE(partition->ComputePartitionForMap(location, owner));
+  }
+  return owner;
+}
+
+TEST(FastMathTest, FastTanhWithinMaxError) {
+  const Eigen::ArrayXd x = Eigen::ArrayXd::LinSpaced(400001, -20.0, 20.0);
+  Eigen::ArrayXd fast = x;
+  utils::FastTanh(fast);
+  for (int i = 0; i < x.size(); ++i) {
+    ASSERT_NEAR(fast(i), std::tanh(x(i)), utils::KFastTanhMaxError)
+        << "x = " << x(i);
+  }
+}
+
+TEST(FastMathTest, FastTanhPartitionMatchesExact) {
+  const std::vector<int> exact = ComputeOwners(false);
+  const std::vector<int> fast = ComputeOwners(true);
+  ASSERT_EQ(exact.size(), KFixtureGridSize * KFixtureGridSize);
+  ASSERT_EQ(exact.size(), fast.size());
+  int mismatches = 0;
+  for (int i = 0; i < exact.size(); ++i) mismatches += exact[i] != fast[i];
+  EXPECT_EQ(mismatches, 0);
+}
+
+}  // namespace partition
+}  // namespace sampling
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,26 @@
+/**
+ * Approximate elementwise math for hot loops that tolerate small errors
+ */
+
+#pragma once
+
+#include <Eigen/Dense>
+
+namespace sampling {
+namespace utils {
+
+// Bound on the absolute error of FastTanh against std::tanh, a few ulps of
+// 1.0 from the final subtraction
+const double KFastTanhMaxError = 1e-15;
+
+/// Replaces x with tanh(x) = 1 - 2 / (exp(2x) + 1). Unlike std::tanh, Eigen
+/// vectorizes exp for doubles, so this runs on packets. Large |x| saturates
+/// to +-1 through exp overflow and underflow. The tails are not flattened as
+/// by a clamped polynomial, so comparisons of nearly saturated costs still
+/// come out the same as with std::tanh.
+inline void FastTanh(Eigen::Ref<Eigen::ArrayXd> x) {
+  x = 1.0 - 2.0 / ((2.0 * x).exp() + 1.0);
+}
+
+}  // namespace utils
+}  // namespace sampling
@@ -0,0 +1,170 @@
+/**
+ * Uniform grid index over 2D locations for radius and nearest queries
+ */
+
+#pragma once
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace sampling {
+namespace utils {
+
+// Average number of locations per bin when the bin size is not given
+const double KGridIndexLocationsPerBin = 4.0;
+
+class GridIndex {
+ public:
+  GridIndex() = delete;
+
+  /// Indexes the rows of an N x 2 location matrix, the bin size is chosen
+  /// from the bounding box so that bins hold a few locations each.
+  explicit GridIndex(const Eigen::MatrixXd &locations)
+      : GridIndex(locations, DefaultBinSize(locations)) {}
+
+  GridIndex(const Eigen::MatrixXd &locations, const double &bin_size)
+      : x_(locations.col(0).array()),
+        y_(locations.col(1).array()),
+        bin_size_(bin_size > 0.0 ? bin_size : 1.0),
+        min_x_(0.0),
+        min_y_(0.0),
+        num_bins_x_(1),
+        num_bins_y_(1) {
+    if (x_.size() > 0) {
+      min_x_ = x_.minCoeff();
+      min_y_ = y_.minCoeff();
+      num_bins_x_ = int(std::floor((x_.maxCoeff() - min_x_) / bin_size_)) + 1;
+      num_bins_y_ = int(std::floor((y_.maxCoeff() - min_y_) / bin_size_)) + 1;
+    }
+
+    // Counting sort of the rows by bin, bin b holds
+    // bin_rows_[bin_start_[b], bin_start_[b + 1])
+    const int num_locations = Size();
+    const int num_bins = num_bins_x_ * num_bins_y_;
+    std::vector<int> bin(num_locations);
+    bin_start_.assign(num_bins + 1, 0);
+    for (int i = 0; i < num_locations; ++i) {
+      bin[i] = BinIndex(y_(i) - min_y_, num_bins_y_) * num_bins_x_ +
+               BinIndex(x_(i) - min_x_, num_bins_x_);
+      ++bin_start_[bin[i] + 1];
+    }
+    for (int b = 0; b < num_bins; ++b) {
+      bin_start_[b + 1] += bin_start_[b];
+    }
+    std::vector<int> next(bin_start_.begin(), bin_start_.end() - 1);
+    bin_rows_.resize(num_locations);
+    for (int i = 0; i < num_locations; ++i) bin_rows_[next[bin[i]]++] = i;
+  }
+
+  int Size() const { return x_.size(); }
+
+  /// Rows within radius (inclusive) of (x, y), in no particular order.
+  void RadiusSearch(const double &x, const double &y, const double &radius,
+                    std::vector<int> &rows) const {
+    rows.clear();
+    if (Size() == 0 || radius < 0.0) return;
+    const int x_begin = BinIndex(x - radius - min_x_, num_bins_x_);
+    const int x_end = BinIndex(x + radius - min_x_, num_bins_x_);
+    const int y_begin = BinIndex(y - radius - min_y_, num_bins_y_);
+    const int y_end = BinIndex(y + radius - min_y_, num_bins_y_);
+    for (int by = y_begin; by <= y_end; ++by) {
+      for (int bx = x_begin; bx <= x_end; ++bx) {
+        const int b = by * num_bins_x_ + bx;
+        for (int k = bin_start_[b]; k < bin_start_[b + 1]; ++k) {
+          const int i = bin_rows_[k];
+          const double dx = x_(i) - x;
+          const double dy = y_(i) - y;
+          if (std::sqrt(dx * dx + dy * dy) <= radius) rows.push_back(i);
+        }
+      }
+    }
+  }
+
+  /// Row closest to (x, y), the lowest row on ties, -1 if nothing is
+  /// indexed. Visits rings of bins around the query until no closer row
+  /// can be left.
+  int NearestSearch(const double &x, const double &y) const {
+    if (Size() == 0) return -1;
+    const int center_x = BinIndex(x - min_x_, num_bins_x_);
+    const int center_y = BinIndex(y - min_y_, num_bins_y_);
+    const int max_ring = std::max(num_bins_x_, num_bins_y_);
+    int nearest = -1;
+    double nearest_sqdist = std::numeric_limits<double>::infinity();
+    for (int ring = 0; ring <= max_ring; ++ring) {
+      for (int by = center_y - ring; by <= center_y + ring; ++by) {
+        if (by < 0 || by >= num_bins_y_) continue;
+        // Only the border of the ring, inner bins were visited before
+        const int step = (by == center_y - ring || by == center_y + ring)
+                             ? 1
+                             : std::max(1, 2 * ring);
+        for (int bx = center_x - ring; bx <= center_x + ring; bx += step) {
+          if (bx < 0 || bx >= num_bins_x_) continue;
+          const int b = by * num_bins_x_ + bx;
+          for (int k = bin_start_[b]; k < bin_start_[b + 1]; ++k) {
+            const int i = bin_rows_[k];
+            const double dx = x_(i) - x;
+            const double dy = y_(i) - y;
+            const double sqdist = dx * dx + dy * dy;
+            if (sqdist < nearest_sqdist ||
+                (sqdist == nearest_sqdist && i < nearest)) {
+              nearest_sqdist = sqdist;
+              nearest = i;
+            }
+          }
+        }
+      }
+      // Rows in later rings are at least ring * bin_size_ away
+      const double ring_distance = ring * bin_size_;
+      if (nearest >= 0 && nearest_sqdist < ring_distance * ring_distance) {
+        break;
+      }
+    }
+    return nearest;
+  }
+
+ private:
+  static double DefaultBinSize(const Eigen::MatrixXd &locations) {
+    if (locations.rows() == 0) return 1.0;
+    const double width =
+        locations.col(0).maxCoeff() - locations.col(0).minCoeff();
+    const double height =
+        locations.col(1).maxCoeff() - locations.col(1).minCoeff();
+    const double extent = std::max(width, height);
+    if (extent <= 0.0) return 1.0;
+    // A line of locations is given a width of extent / N so that its bins
+    // still hold a few locations each
+    const double area = std::max(width, extent / locations.rows()) *
+                        std::max(height, extent / locations.rows());
+    return std::sqrt(area * KGridIndexLocationsPerBin / locations.rows());
+  }
+
+  /// Bin of an offset from the grid origin, clamped into the grid
+  int BinIndex(const double &offset, const int &num_bins) const {
+    const double bin = std::floor(offset / bin_size_);
+    return int(std::min(std::max(bin, 0.0), double(num_bins - 1)));
+  }
+
+  Eigen::ArrayXd x_;
+
+  Eigen::ArrayXd y_;
+
+  double bin_size_;
+
+  double min_x_;
+
+  double min_y_;
+
+  int num_bins_x_;
+
+  int num_bins_y_;
+
+  std::vector<int> bin_start_;
+
+  std::vector<int> bin_rows_;
+};
+
+}  // namespace utils
+}  // namespace sampling
@@ -0,0 +1,68 @@
+/**
+ * Unbounded lock-free multi-producer single-consumer queue
+ * reference: http://www.1024cores.net/home/lock-free-algorithms/queues/
+ * non-intrusive-mpsc-node-based-queue
+ */
+
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+namespace sampling {
+namespace utils {
+
+template <typename T>
+class MPSCQueue {
+ public:
+  MPSCQueue() : head_(new Node()), tail_(head_.load()) {}
+
+  MPSCQueue(const MPSCQueue &) = delete;
+
+  MPSCQueue &operator=(const MPSCQueue &) = delete;
+
+  ~MPSCQueue() {
+    T value;
+    while (Pop(value)) {
+    }
+    delete tail_;
+  }
+
+  /// Safe to call from any number of threads, never blocks.
+  void Push(T value) {
+    Node *node = new Node(std::move(value));
+    Node *prev = head_.exchange(node, std::memory_order_acq_rel);
+    prev->next.store(node, std::memory_order_release);
+  }
+
+  /// Single consumer only. May miss an element whose Push has not finished
+  /// yet, it is returned by a later call.
+  bool Pop(T &value) {
+    Node *next = tail_->next.load(std::memory_order_acquire);
+    if (next == nullptr) return false;
+    value = std::move(next->value);
+    delete tail_;
+    tail_ = next;
+    return true;
+  }
+
+ private:
+  struct Node {
+    Node() : next(nullptr) {}
+
+    explicit Node(T node_value) : value(std::move(node_value)), next(nullptr) {}
+
+    T value;
+
+    std::atomic<Node *> next;
+  };
+
+  // Last pushed node, shared by producers
+  std::atomic<Node *> head_;
+
+  // Sentinel before the oldest element, owned by the consumer
+  Node *tail_;
+};
+
+}  // namespace utils
+}  // namespace sampling
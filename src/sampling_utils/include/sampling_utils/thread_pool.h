@@ -0,0 +1,95 @@
+/**
+ * Fixed size thread pool for data parallel loops
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace sampling {
+namespace utils {
+
+class ThreadPool {
+ public:
+  ThreadPool() = delete;
+
+  /// Non-positive thread count uses all hardware threads
+  explicit ThreadPool(const int &num_threads) : stop_(false) {
+    int num_workers = num_threads > 0
+                          ? num_threads
+                          : int(std::thread::hardware_concurrency());
+    num_workers = std::max(1, num_workers);
+    workers_.reserve(num_workers);
+    for (int i = 0; i < num_workers; ++i) {
+      workers_.emplace_back(&ThreadPool::WorkerLoop, this);
+    }
+  }
+
+  ~ThreadPool() {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    condition_.notify_all();
+    for (std::thread &worker : workers_) worker.join();
+  }
+
+  /// Runs task(i) for every i in [0, num_tasks) and blocks until all of them
+  /// are done. Must not be called from inside a task of the same pool.
+  void ParallelFor(const int &num_tasks, const std::function<void(int)> &task) {
+    if (num_tasks <= 0) return;
+    if (num_tasks == 1) {
+      task(0);
+      return;
+    }
+    std::vector<std::future<void>> results;
+    results.reserve(num_tasks);
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      for (int i = 0; i < num_tasks; ++i) {
+        std::packaged_task<void()> job(std::bind(task, i));
+        results.push_back(job.get_future());
+        jobs_.push(std::move(job));
+      }
+    }
+    condition_.notify_all();
+    for (std::future<void> &result : results) result.get();
+  }
+
+  int GetNumThreads() const { return workers_.size(); }
+
+ private:
+  void WorkerLoop() {
+    while (true) {
+      std::packaged_task<void()> job;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        condition_.wait(lock, [this] { return stop_ || !jobs_.empty(); });
+        if (stop_ && jobs_.empty()) return;
+        job = std::move(jobs_.front());
+        jobs_.pop();
+      }
+      job();
+    }
+  }
+
+  std::vector<std::thread> workers_;
+
+  std::queue<std::packaged_task<void()>> jobs_;
+
+  std::mutex mutex_;
+
+  std::condition_variable condition_;
+
+  bool stop_;
+};
+
+}  // namespace utils
+}  // namespace sampling